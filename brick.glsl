@@ -0,0 +1,52 @@
+layout(set = 0, binding = 0, r8ui) uniform readonly uimage3D cells;
+layout(set = 0, binding = 1, r8ui) uniform readonly uimage3D cells2;
+layout(set = 0, binding = 2, r8ui) uniform readonly uimage3D cells4;
+layout(set = 0, binding = 3) buffer readonly bufferBricks
+{
+    uint bricks[];
+};
+layout(set = 1, binding = 0) uniform uniformViewProjMatrix
+{
+    mat4 viewProjMatrix;
+};
+layout(set = 1, binding = 1) uniform uniformDraw
+{
+    uint brickOffset;
+    uint lod;
+    vec2 splatScale;
+};
+
+uint Load(ivec3 id)
+{
+    switch (lod)
+    {
+    case 0:
+        return imageLoad(cells, id).x;
+    case 1:
+        return imageLoad(cells2, id).x;
+    }
+    return imageLoad(cells4, id).x;
+}
+
+/* a block is the max of the 2^lod cells along each axis */
+ivec3 GetBlock()
+{
+    uint blocks = BRICK >> lod;
+    uint brick = bricks[brickOffset + uint(gl_InstanceIndex) / (blocks * blocks * blocks)];
+    uint block = uint(gl_InstanceIndex) % (blocks * blocks * blocks);
+    ivec3 id;
+    id.x = int(((brick >>  0) & 0x3FF) * blocks + block % blocks);
+    id.y = int(((brick >> 10) & 0x3FF) * blocks + (block / blocks) % blocks);
+    id.z = int(((brick >> 20) & 0x3FF) * blocks + block / (blocks * blocks));
+    return id;
+}
+
+uint GetValue(ivec3 id)
+{
+    int scale = 1 << lod;
+    if (any(greaterThanEqual(id, ivec3((BOUNDS + scale - 1) / scale))))
+    {
+        return 0;
+    }
+    return Load(id);
+}
\ No newline at end of file
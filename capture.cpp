@@ -0,0 +1,455 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture.hpp"
+#include "config.hpp"
+#include "trace.hpp"
+
+enum
+{
+    FORMAT_PPM,
+    FORMAT_PNG,
+    FORMAT_Y4M,
+};
+
+struct Slot
+{
+    SDL_GPUTransferBuffer* buffer;
+    SDL_GPUFence* fence;
+};
+
+/* in flight downloads, oldest first starting at head */
+static Slot slots[CAPTURES];
+static int head;
+static int count;
+
+static std::thread thread;
+static std::mutex mutex;
+static std::condition_variable condition;
+static std::vector<uint8_t> queue[CAPTURE_QUEUE];
+static int queueHead;
+static int queueCount;
+static bool stopping;
+static bool capturing;
+
+static std::string pattern;
+static int format;
+static int width;
+static int height;
+static std::ofstream stream;
+
+static bool HasExtension(const std::string& path, const char* extension)
+{
+    size_t length = std::strlen(extension);
+    return path.size() >= length && !SDL_strcasecmp(path.c_str() + path.size() - length, extension);
+}
+
+/* the pattern reaches snprintf so it may only hold a single %d, with an
+ * optional zero padded width, besides escaped percent signs */
+static bool IsPattern(const std::string& path)
+{
+    int conversions = 0;
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        if (path[i] != '%')
+        {
+            continue;
+        }
+        if (i + 1 < path.size() && path[i + 1] == '%')
+        {
+            i++;
+            continue;
+        }
+        size_t j = i + 1;
+        while (j < path.size() && path[j] >= '0' && path[j] <= '9')
+        {
+            j++;
+        }
+        if (j == path.size() || path[j] != 'd' || j - i > 4)
+        {
+            return false;
+        }
+        conversions++;
+        i = j;
+    }
+    return conversions == 1;
+}
+
+static std::string GetPath(int frame)
+{
+    char path[512];
+    if (pattern.find('%') != std::string::npos)
+    {
+        SDL_snprintf(path, sizeof(path), pattern.c_str(), frame);
+        return path;
+    }
+    /* numbered before the extension */
+    size_t dot = pattern.rfind('.');
+    SDL_snprintf(path, sizeof(path), "%s_%05d%s", pattern.substr(0, dot).c_str(), frame, pattern.substr(dot).c_str());
+    return path;
+}
+
+static void WriteBigEndian(std::vector<uint8_t>& data, uint32_t value)
+{
+    data.push_back(value >> 24);
+    data.push_back(value >> 16);
+    data.push_back(value >> 8);
+    data.push_back(value);
+}
+
+static uint32_t GetCrc(const uint8_t* data, size_t size)
+{
+    static uint32_t table[256];
+    if (!table[1])
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t value = i;
+            for (int j = 0; j < 8; j++)
+            {
+                value = value & 1 ? 0xEDB88320 ^ (value >> 1) : value >> 1;
+            }
+            table[i] = value;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFF;
+}
+
+static void WriteChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data)
+{
+    std::vector<uint8_t> chunk;
+    WriteBigEndian(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    WriteBigEndian(chunk, GetCrc(chunk.data() + 4, chunk.size() - 4));
+    file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+static bool WritePpm(const std::string& path, const uint8_t* pixels)
+{
+    std::ofstream file(path, std::ios::binary);
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(width * 3);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            std::memcpy(row.data() + x * 3, pixels + (y * width + x) * 4, 3);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return !file.fail();
+}
+
+/* stored deflate blocks since there is no compressor to link against */
+static bool WritePng(const std::string& path, const uint8_t* pixels)
+{
+    std::ofstream file(path, std::ios::binary);
+    static constexpr uint8_t Signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write(reinterpret_cast<const char*>(Signature), sizeof(Signature));
+    std::vector<uint8_t> header;
+    WriteBigEndian(header, width);
+    WriteBigEndian(header, height);
+    header.insert(header.end(), {8, 2, 0, 0, 0});
+    WriteChunk(file, "IHDR", header);
+    /* every row starts with filter type none */
+    std::vector<uint8_t> raw;
+    raw.reserve((width * 3 + 1) * height);
+    for (int y = 0; y < height; y++)
+    {
+        raw.push_back(0);
+        for (int x = 0; x < width; x++)
+        {
+            raw.insert(raw.end(), pixels + (y * width + x) * 4, pixels + (y * width + x) * 4 + 3);
+        }
+    }
+    std::vector<uint8_t> data{0x78, 0x01};
+    for (size_t i = 0; i < raw.size(); i += 65535)
+    {
+        uint16_t size = std::min<size_t>(65535, raw.size() - i);
+        data.push_back(i + size == raw.size());
+        data.push_back(size);
+        data.push_back(size >> 8);
+        data.push_back(~size);
+        data.push_back(~size >> 8);
+        data.insert(data.end(), raw.begin() + i, raw.begin() + i + size);
+    }
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    WriteBigEndian(data, b << 16 | a);
+    WriteChunk(file, "IDAT", data);
+    WriteChunk(file, "IEND", {});
+    return !file.fail();
+}
+
+/* bt.601 limited range with chroma averaged over 2x2 pixels */
+static bool WriteY4m(const uint8_t* pixels)
+{
+    std::vector<uint8_t> planes(width * height * 3 / 2);
+    uint8_t* u = planes.data() + width * height;
+    uint8_t* v = u + width * height / 4;
+    for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+    {
+        const uint8_t* pixel = pixels + (y * width + x) * 4;
+        planes[y * width + x] = (66 * pixel[0] + 129 * pixel[1] + 25 * pixel[2] + 128 + 4096) >> 8;
+    }
+    for (int y = 0; y < height / 2; y++)
+    for (int x = 0; x < width / 2; x++)
+    {
+        int r = 0;
+        int g = 0;
+        int b = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            const uint8_t* pixel = pixels + ((y * 2 + i / 2) * width + x * 2 + i % 2) * 4;
+            r += pixel[0];
+            g += pixel[1];
+            b += pixel[2];
+        }
+        r /= 4;
+        g /= 4;
+        b /= 4;
+        u[y * width / 2 + x] = (-38 * r - 74 * g + 112 * b + 128 + 32768) >> 8;
+        v[y * width / 2 + x] = (112 * r - 94 * g - 18 * b + 128 + 32768) >> 8;
+    }
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+    return !stream.fail();
+}
+
+static void Run()
+{
+    SetTraceThread("Capture");
+    std::vector<uint8_t> pixels(width * height * 4);
+    int frame = 0;
+    bool failed = false;
+    while (true)
+    {
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [] { return queueCount || stopping; });
+            if (!queueCount)
+            {
+                break;
+            }
+            pixels.swap(queue[queueHead]);
+            queueHead = (queueHead + 1) % CAPTURE_QUEUE;
+            queueCount--;
+        }
+        condition.notify_all();
+        TRACE_SCOPE("Capture");
+        bool written;
+        switch (format)
+        {
+        case FORMAT_PPM:
+            written = WritePpm(GetPath(frame), pixels.data());
+            break;
+        case FORMAT_PNG:
+            written = WritePng(GetPath(frame), pixels.data());
+            break;
+        default:
+            written = WriteY4m(pixels.data());
+            break;
+        }
+        if (!written && !failed)
+        {
+            SDL_Log("Failed to write frame %d", frame);
+            failed = true;
+        }
+        frame++;
+    }
+}
+
+bool StartCapture(SDL_GPUDevice* device, const char* path, int captureWidth, int captureHeight, int fps)
+{
+    pattern = path;
+    width = captureWidth;
+    height = captureHeight;
+    if (HasExtension(pattern, ".ppm"))
+    {
+        format = FORMAT_PPM;
+    }
+    else if (HasExtension(pattern, ".png"))
+    {
+        format = FORMAT_PNG;
+    }
+    else if (HasExtension(pattern, ".y4m"))
+    {
+        format = FORMAT_Y4M;
+    }
+    else
+    {
+        SDL_Log("Unknown capture format, expected .ppm, .png or .y4m: %s", path);
+        return false;
+    }
+    if (format != FORMAT_Y4M && pattern.find('%') != std::string::npos && !IsPattern(pattern))
+    {
+        SDL_Log("Capture path can only number frames through a single %%d: %s", path);
+        return false;
+    }
+    if (format == FORMAT_Y4M)
+    {
+        if (width % 2 || height % 2)
+        {
+            SDL_Log("Y4M needs an even width and height");
+            return false;
+        }
+        stream.open(path, std::ios::binary);
+        if (stream.fail())
+        {
+            SDL_Log("Failed to open capture: %s", path);
+            stream.clear();
+            return false;
+        }
+        stream << "YUV4MPEG2 W" << width << " H" << height << " F" << fps << ":1 Ip A1:1 C420jpeg\n";
+    }
+    for (int i = 0; i < CAPTURES; i++)
+    {
+        SDL_GPUTransferBufferCreateInfo info{};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+        info.size = width * height * 4;
+        slots[i].buffer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!slots[i].buffer)
+        {
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+    }
+    for (std::vector<uint8_t>& pixels : queue)
+    {
+        pixels.resize(width * height * 4);
+    }
+    head = 0;
+    count = 0;
+    queueHead = 0;
+    queueCount = 0;
+    stopping = false;
+    thread = std::thread(Run);
+    capturing = true;
+    return true;
+}
+
+void StopCapture(SDL_GPUDevice* device)
+{
+    if (!capturing)
+    {
+        return;
+    }
+    PollCaptures(device, true);
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    /* drains the queue first */
+    thread.join();
+    capturing = false;
+    stream.close();
+    stream.clear();
+    for (Slot& slot : slots)
+    {
+        SDL_ReleaseGPUTransferBuffer(device, slot.buffer);
+        slot = {};
+    }
+    for (std::vector<uint8_t>& pixels : queue)
+    {
+        pixels = {};
+    }
+}
+
+bool RequestCapture(SDL_GPUDevice* device, SDL_GPUTexture* texture)
+{
+    /* unlike the cells no frame of a video can be dropped */
+    if (count == CAPTURES)
+    {
+        SDL_WaitForGPUFences(device, true, &slots[head].fence, 1);
+        PollCaptures(device, false);
+    }
+    Slot& slot = slots[(head + count) % CAPTURES];
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return false;
+    }
+    SDL_GPUTextureRegion region{};
+    SDL_GPUTextureTransferInfo info{};
+    region.texture = texture;
+    region.w = width;
+    region.h = height;
+    region.d = 1;
+    info.transfer_buffer = slot.buffer;
+    SDL_DownloadFromGPUTexture(copyPass, &region, &info);
+    SDL_EndGPUCopyPass(copyPass);
+    slot.fence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    if (!slot.fence)
+    {
+        SDL_Log("Failed to submit command buffer: %s", SDL_GetError());
+        return false;
+    }
+    count++;
+    return true;
+}
+
+void PollCaptures(SDL_GPUDevice* device, bool wait)
+{
+    while (count)
+    {
+        Slot& slot = slots[head];
+        if (wait)
+        {
+            SDL_WaitForGPUFences(device, true, &slot.fence, 1);
+        }
+        else if (!SDL_QueryGPUFence(device, slot.fence))
+        {
+            break;
+        }
+        SDL_ReleaseGPUFence(device, slot.fence);
+        slot.fence = nullptr;
+        head = (head + 1) % CAPTURES;
+        count--;
+        const uint8_t* data = static_cast<const uint8_t*>(SDL_MapGPUTransferBuffer(device, slot.buffer, false));
+        if (!data)
+        {
+            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            continue;
+        }
+        {
+            /* waits when the writer falls behind */
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [] { return queueCount < CAPTURE_QUEUE; });
+            std::memcpy(queue[(queueHead + queueCount) % CAPTURE_QUEUE].data(), data, width * height * 4);
+            queueCount++;
+        }
+        condition.notify_all();
+        SDL_UnmapGPUTransferBuffer(device, slot.buffer);
+    }
+}
\ No newline at end of file
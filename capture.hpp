@@ -0,0 +1,11 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+/* rendered frames are downloaded like the cells in readback.cpp and written
+ * by a thread as numbered ppm or png files or a single y4m stream, picked by
+ * the extension of the path (which numbers files through a %d if it has one) */
+bool StartCapture(SDL_GPUDevice* device, const char* path, int width, int height, int fps);
+void StopCapture(SDL_GPUDevice* device);
+bool RequestCapture(SDL_GPUDevice* device, SDL_GPUTexture* texture);
+void PollCaptures(SDL_GPUDevice* device, bool wait);
\ No newline at end of file
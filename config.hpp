@@ -3,7 +3,74 @@
 
 #define BOUNDS 128
 #define THREADS 8
-#define FRAMES 2
+#define FRAMES 4
+
+/* occupancy (one workgroup reduces one brick) */
+#define BRICK THREADS
+#define LEVELS 3
+
+/* level of detail (cells are merged until they cover LOD_PIXELS) */
+#define LODS 3
+#define LOD_PIXELS 1.0f
+
+/* occlusion */
+#define HIZ_LEVELS 16
+
+/* most generations submitted per frame */
+#define GENERATIONS 64
+
+/* fast forward (generations per batch and ms between progress redraws) */
+#define FAST_FORWARD 256
+#define FAST_FORWARD_INTERVAL 250
+
+/* cpu engine history (default budget and generations between keyframes) */
+#define HISTORY_MEGABYTES 256
+#define HISTORY_KEYFRAME 64
+
+/* cells per side of a snapshot brick */
+#define SNAPSHOT_BRICK 32
+
+/* cell downloads in flight (a recorded batch needs one per generation) */
+#define READBACKS 16
+
+/* recorder (frames queued for the writer thread and frames between keyframes) */
+#define RECORD_QUEUE 16
+#define RECORD_KEYFRAME 64
+
+/* generations kept in the shared memory ring */
+#define PUBLISH_SLOTS 8
+
+/* streaming (generations queued for the sending thread and ms before a
+ * viewer that stopped reading is dropped) */
+#define STREAM_QUEUE 8
+#define STREAM_TIMEOUT 5000
+
+/* out of core grids (slices read ahead and written behind, and generations
+ * stepped per pass over the file) */
+#define SLAB_QUEUE 4
+#define SLAB_STEPS 4
+
+/* unbounded worlds (cells per side of a chunk, default resident budget and
+ * generations a chunk goes unread before it can be paged out) */
+#define WORLD_CHUNK 32
+#define WORLD_MEGABYTES 256
+#define WORLD_STILL 16
+
+/* headless rendering (frames downloading, frames waiting for the writer
+ * thread and frames per second of y4m streams) */
+#define CAPTURES 3
+#define CAPTURE_QUEUE 8
+#define CAPTURE_FPS 30
+
+/* loop iterations kept by the profiler */
+#define PROFILE_SAMPLES 240
+
+/* tracing (events buffered per thread and most threads traced) */
+#define TRACE_EVENTS 65536
+#define TRACE_THREADS 16
+
+/* frames drawn after an event before going idle */
+#define REDRAWS 2
 
 /* neighborhoods */
 #define MOORE 0
@@ -0,0 +1,181 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "config.hpp"
+#include "delta.hpp"
+
+static constexpr size_t Size = BOUNDS * BOUNDS * BOUNDS;
+
+static uint8_t* WriteVarint(uint8_t* data, size_t value)
+{
+    while (value >= 0x80)
+    {
+        *data++ = value | 0x80;
+        value >>= 7;
+    }
+    *data++ = value;
+    return data;
+}
+
+static bool ReadVarint(const uint8_t*& data, const uint8_t* end, size_t& value)
+{
+    value = 0;
+    for (int shift = 0; data < end && shift < 64; shift += 7)
+    {
+        uint8_t byte = *data++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void Decay(const uint8_t* cells, uint8_t* decayed)
+{
+    for (size_t i = 0; i < Size; i++)
+    {
+        decayed[i] = cells[i] ? cells[i] - 1 : 0;
+    }
+}
+
+static uint64_t Load(const uint8_t* data)
+{
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+/* worst case is single zeros between single literals at 3 bytes per 2 cells */
+static size_t GetBound(size_t size)
+{
+    return size * 2 + 16;
+}
+
+static uint8_t* Encode(const uint8_t* cells, const uint8_t* previous, size_t size, uint8_t* output)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t start = i;
+        /* skip unchanged words before falling back to bytes */
+        while (i + 8 <= size && Load(cells + i) == (previous ? Load(previous + i) : 0))
+        {
+            i += 8;
+        }
+        if (previous)
+        {
+            while (i < size && cells[i] == previous[i])
+            {
+                i++;
+            }
+        }
+        else
+        {
+            while (i < size && !cells[i])
+            {
+                i++;
+            }
+        }
+        output = WriteVarint(output, i - start);
+        start = i;
+        if (previous)
+        {
+            while (i < size && cells[i] != previous[i])
+            {
+                i++;
+            }
+        }
+        else
+        {
+            while (i < size && cells[i])
+            {
+                i++;
+            }
+        }
+        output = WriteVarint(output, i - start);
+        for (size_t j = start; j < i; j++)
+        {
+            *output++ = previous ? cells[j] ^ previous[j] : cells[j];
+        }
+    }
+    return output;
+}
+
+static bool Decode(const uint8_t* data, size_t size, uint8_t* cells, size_t count, bool keyframe)
+{
+    /* the data may come straight from a file so every run is checked */
+    const uint8_t* end = data + size;
+    size_t i = 0;
+    while (i < count)
+    {
+        size_t zeros;
+        if (!ReadVarint(data, end, zeros) || zeros > count - i)
+        {
+            return false;
+        }
+        if (keyframe)
+        {
+            std::memset(cells + i, 0, zeros);
+        }
+        i += zeros;
+        size_t literals;
+        if (!ReadVarint(data, end, literals) || literals > count - i || literals > static_cast<size_t>(end - data))
+        {
+            return false;
+        }
+        if (!zeros && !literals)
+        {
+            return false;
+        }
+        if (keyframe)
+        {
+            std::memcpy(cells + i, data, literals);
+        }
+        else
+        {
+            for (size_t j = 0; j < literals; j++)
+            {
+                cells[i + j] ^= data[j];
+            }
+        }
+        data += literals;
+        i += literals;
+    }
+    return true;
+}
+
+void EncodeDelta(const uint8_t* cells, const uint8_t* previous, std::vector<uint8_t>& data)
+{
+    thread_local std::vector<uint8_t> scratch(GetBound(Size));
+    thread_local std::vector<uint8_t> decayed(Size);
+    if (previous)
+    {
+        Decay(previous, decayed.data());
+        previous = decayed.data();
+    }
+    data.assign(scratch.data(), Encode(cells, previous, Size, scratch.data()));
+}
+
+bool DecodeDelta(const uint8_t* data, size_t size, uint8_t* cells, bool keyframe)
+{
+    if (!keyframe)
+    {
+        Decay(cells, cells);
+    }
+    return Decode(data, size, cells, Size, keyframe);
+}
+
+void EncodeRuns(const uint8_t* bytes, size_t size, std::vector<uint8_t>& data)
+{
+    data.resize(GetBound(size));
+    data.resize(Encode(bytes, nullptr, size, data.data()) - data.data());
+}
+
+bool DecodeRuns(const uint8_t* data, size_t size, uint8_t* bytes, size_t count)
+{
+    return Decode(data, size, bytes, count, true);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/* alternating varint runs of zeros and literals over the cells, xored with
+ * previous when given after counting it down, since most live cells decay */
+void EncodeDelta(const uint8_t* cells, const uint8_t* previous, std::vector<uint8_t>& data);
+bool DecodeDelta(const uint8_t* data, size_t size, uint8_t* cells, bool keyframe);
+
+/* the same runs without a previous frame, over any number of bytes */
+void EncodeRuns(const uint8_t* bytes, size_t size, std::vector<uint8_t>& data);
+bool DecodeRuns(const uint8_t* data, size_t size, uint8_t* bytes, size_t count);
\ No newline at end of file
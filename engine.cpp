@@ -0,0 +1,452 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include "engine.hpp"
+#include "history.hpp"
+#include "trace.hpp"
+
+/* generations remembered for building dirty ranges */
+#define RANGES 64
+
+static constexpr float Gradients[] =
+{
+    0.f, 1.f, 1.f, 0.f,  0.f,-1.f, 1.f, 0.f,  0.f, 1.f,-1.f, 0.f,  0.f,-1.f,-1.f, 0.f,
+    1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f,  1.f, 0.f,-1.f, 0.f, -1.f, 0.f,-1.f, 0.f,
+    1.f, 1.f, 0.f, 0.f, -1.f, 1.f, 0.f, 0.f,  1.f,-1.f, 0.f, 0.f, -1.f,-1.f, 0.f, 0.f,
+    0.f, 1.f, 1.f, 0.f,  0.f,-1.f, 1.f, 0.f,  0.f, 1.f,-1.f, 0.f,  0.f,-1.f,-1.f, 0.f,
+    1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f,  1.f, 0.f,-1.f, 0.f, -1.f, 0.f,-1.f, 0.f,
+    1.f, 1.f, 0.f, 0.f, -1.f, 1.f, 0.f, 0.f,  1.f,-1.f, 0.f, 0.f, -1.f,-1.f, 0.f, 0.f,
+    0.f, 1.f, 1.f, 0.f,  0.f,-1.f, 1.f, 0.f,  0.f, 1.f,-1.f, 0.f,  0.f,-1.f,-1.f, 0.f,
+    1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f,  1.f, 0.f,-1.f, 0.f, -1.f, 0.f,-1.f, 0.f,
+    1.f, 1.f, 0.f, 0.f, -1.f, 1.f, 0.f, 0.f,  1.f,-1.f, 0.f, 0.f, -1.f,-1.f, 0.f, 0.f,
+    0.f, 1.f, 1.f, 0.f,  0.f,-1.f, 1.f, 0.f,  0.f, 1.f,-1.f, 0.f,  0.f,-1.f,-1.f, 0.f,
+    1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f,  1.f, 0.f,-1.f, 0.f, -1.f, 0.f,-1.f, 0.f,
+    1.f, 1.f, 0.f, 0.f, -1.f, 1.f, 0.f, 0.f,  1.f,-1.f, 0.f, 0.f, -1.f,-1.f, 0.f, 0.f,
+    0.f, 1.f, 1.f, 0.f,  0.f,-1.f, 1.f, 0.f,  0.f, 1.f,-1.f, 0.f,  0.f,-1.f,-1.f, 0.f,
+    1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f,  1.f, 0.f,-1.f, 0.f, -1.f, 0.f,-1.f, 0.f,
+    1.f, 1.f, 0.f, 0.f, -1.f, 1.f, 0.f, 0.f,  1.f,-1.f, 0.f, 0.f, -1.f,-1.f, 0.f, 0.f,
+    1.f, 1.f, 0.f, 0.f,  0.f,-1.f, 1.f, 0.f, -1.f, 1.f, 0.f, 0.f,  0.f,-1.f,-1.f, 0.f
+};
+
+static constexpr int PrimeX = 501125321;
+static constexpr int PrimeY = 1136930381;
+static constexpr int PrimeZ = 1720413743;
+
+static constexpr int Moore[26][3] =
+{
+    {-1,-1,-1}, { 0,-1,-1}, { 1,-1,-1},
+    {-1, 0,-1}, { 0, 0,-1}, { 1, 0,-1},
+    {-1, 1,-1}, { 0, 1,-1}, { 1, 1,-1},
+    {-1,-1, 0}, { 0,-1, 0}, { 1,-1, 0},
+    {-1, 0, 0},             { 1, 0, 0},
+    {-1, 1, 0}, { 0, 1, 0}, { 1, 1, 0},
+    {-1,-1, 1}, { 0,-1, 1}, { 1,-1, 1},
+    {-1, 0, 1}, { 0, 0, 1}, { 1, 0, 1},
+    {-1, 1, 1}, { 0, 1, 1}, { 1, 1, 1},
+};
+
+static constexpr int VonNeumann[6][3] =
+{
+    {-1, 0, 0},
+    { 1, 0, 0},
+    { 0,-1, 0},
+    { 0, 1, 0},
+    { 0, 0,-1},
+    { 0, 0, 1},
+};
+
+/* wrapping int math from FastNoiseLite.glsl */
+static int Multiply(int a, int b)
+{
+    return static_cast<int>(static_cast<uint32_t>(a) * static_cast<uint32_t>(b));
+}
+
+static int Add(int a, int b)
+{
+    return static_cast<int>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b));
+}
+
+static float GetGradient(int seed, int xPrimed, int yPrimed, int zPrimed, float xd, float yd, float zd)
+{
+    int hash = Multiply(seed ^ xPrimed ^ yPrimed ^ zPrimed, 0x27d4eb2d);
+    hash ^= hash >> 15;
+    hash &= 63 << 2;
+    return xd * Gradients[hash] + yd * Gradients[hash | 1] + zd * Gradients[hash | 2];
+}
+
+/* written out like mix() rather than std::lerp so rounding matches */
+static float Lerp(float a, float b, float t)
+{
+    return a * (1.f - t) + b * t;
+}
+
+static float GetQuintic(float t)
+{
+    return t * t * t * (t * (t * 6.f - 15.f) + 10.f);
+}
+
+static float GetPerlin(int seed, float x, float y, float z)
+{
+    int x0 = static_cast<int>(std::floor(x));
+    int y0 = static_cast<int>(std::floor(y));
+    int z0 = static_cast<int>(std::floor(z));
+    float xd0 = x - static_cast<float>(x0);
+    float yd0 = y - static_cast<float>(y0);
+    float zd0 = z - static_cast<float>(z0);
+    float xd1 = xd0 - 1.f;
+    float yd1 = yd0 - 1.f;
+    float zd1 = zd0 - 1.f;
+    float xs = GetQuintic(xd0);
+    float ys = GetQuintic(yd0);
+    float zs = GetQuintic(zd0);
+    x0 = Multiply(x0, PrimeX);
+    y0 = Multiply(y0, PrimeY);
+    z0 = Multiply(z0, PrimeZ);
+    int x1 = Add(x0, PrimeX);
+    int y1 = Add(y0, PrimeY);
+    int z1 = Add(z0, PrimeZ);
+    float xf00 = Lerp(GetGradient(seed, x0, y0, z0, xd0, yd0, zd0), GetGradient(seed, x1, y0, z0, xd1, yd0, zd0), xs);
+    float xf10 = Lerp(GetGradient(seed, x0, y1, z0, xd0, yd1, zd0), GetGradient(seed, x1, y1, z0, xd1, yd1, zd0), xs);
+    float xf01 = Lerp(GetGradient(seed, x0, y0, z1, xd0, yd0, zd1), GetGradient(seed, x1, y0, z1, xd1, yd0, zd1), xs);
+    float xf11 = Lerp(GetGradient(seed, x0, y1, z1, xd0, yd1, zd1), GetGradient(seed, x1, y1, z1, xd1, yd1, zd1), xs);
+    float yf0 = Lerp(xf00, xf10, ys);
+    float yf1 = Lerp(xf01, xf11, ys);
+    return Lerp(yf0, yf1, zs) * 0.964921414852142333984375f;
+}
+
+static int GetIndex(int x, int y, int z)
+{
+    return (z * BOUNDS + y) * BOUNDS + x;
+}
+
+uint8_t GetSeedCell(uint32_t seed, int x, int y, int z)
+{
+    float frequency = 0.1f;
+    float value = GetPerlin(static_cast<int>(seed), x * frequency, y * frequency, z * frequency);
+    return value > 0.65f;
+}
+
+uint8_t GetNextCell(const Rules& rules, uint8_t cell, uint32_t neighbors)
+{
+    int value = cell;
+    if (value == 0 && (rules.birthMask & (1u << neighbors)))
+    {
+        value = rules.life;
+    }
+    else if (!(rules.surviveMask & (1u << neighbors)))
+    {
+        value--;
+    }
+    return std::max(0, value);
+}
+
+static uint8_t StepCell(const Rules& rules, const uint8_t* inCells, int x, int y, int z)
+{
+    if (rules.frame == 0)
+    {
+        return GetSeedCell(rules.seed, x, y, z);
+    }
+    if (rules.frame == 1)
+    {
+        return inCells[GetIndex(x, y, z)];
+    }
+    const int (*offsets)[3] = Moore;
+    int count = 26;
+    if (rules.neighborhood == VON_NEUMANN)
+    {
+        offsets = VonNeumann;
+        count = 6;
+    }
+    uint32_t neighbors = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int nx = x + offsets[i][0];
+        int ny = y + offsets[i][1];
+        int nz = z + offsets[i][2];
+        if (nx < 0 || ny < 0 || nz < 0 || nx >= BOUNDS || ny >= BOUNDS || nz >= BOUNDS)
+        {
+            continue;
+        }
+        neighbors += inCells[GetIndex(nx, ny, nz)] > 0;
+    }
+    return GetNextCell(rules, inCells[GetIndex(x, y, z)], neighbors);
+}
+
+void Step(const Rules& rules, const uint8_t* inCells, uint8_t* outCells, uint8_t* outBricks, int& minZ, int& maxZ)
+{
+    std::memset(outBricks, 0, ENGINE_BRICKS * ENGINE_BRICKS * ENGINE_BRICKS);
+    minZ = BOUNDS;
+    maxZ = -1;
+    for (int z = 0; z < BOUNDS; z++)
+    for (int y = 0; y < BOUNDS; y++)
+    for (int x = 0; x < BOUNDS; x++)
+    {
+        int index = GetIndex(x, y, z);
+        uint8_t value = StepCell(rules, inCells, x, y, z);
+        outCells[index] = value;
+        if (value != inCells[index])
+        {
+            minZ = std::min(minZ, z);
+            maxZ = std::max(maxZ, z);
+        }
+        uint8_t& brick = outBricks[((z / BRICK) * ENGINE_BRICKS + y / BRICK) * ENGINE_BRICKS + x / BRICK];
+        brick = std::max(brick, value);
+    }
+}
+
+/* the writer owns one frame, the reader owns one and the third is swapped between them */
+static EngineFrame frames[3];
+static int writeIndex{0};
+static int readIndex{1};
+static std::atomic<int> sharedIndex{2};
+static constexpr int Fresh = 4;
+
+/* epoch in the high bits and frame in the low bits of the last acquired frame */
+static std::atomic<uint64_t> acquired{UINT64_MAX};
+static std::atomic<bool> notified;
+static uint32_t engineEvent;
+
+static std::thread thread;
+static std::mutex mutex;
+static std::condition_variable condition;
+static EngineSettings settings;
+static bool running;
+static bool rewinding;
+static uint32_t rewindGeneration;
+
+/* the history itself belongs to the engine thread */
+static std::atomic<uint32_t> historyFirst{1};
+static std::atomic<uint32_t> historyLast{0};
+static std::atomic<size_t> historySize;
+
+static void Publish(EngineFrame& frame, const int ranges[RANGES][2])
+{
+    uint64_t last = acquired.load(std::memory_order_acquire);
+    uint32_t epoch = last >> 32;
+    uint32_t previous = last & UINT32_MAX;
+    if (epoch != frame.epoch || previous >= frame.frame || frame.frame - previous > RANGES)
+    {
+        frame.minZ = 0;
+        frame.maxZ = BOUNDS - 1;
+    }
+    else
+    {
+        frame.minZ = BOUNDS;
+        frame.maxZ = -1;
+        for (uint32_t i = previous + 1; i <= frame.frame; i++)
+        {
+            frame.minZ = std::min(frame.minZ, ranges[i % RANGES][0]);
+            frame.maxZ = std::max(frame.maxZ, ranges[i % RANGES][1]);
+        }
+    }
+    writeIndex = sharedIndex.exchange(writeIndex | Fresh, std::memory_order_acq_rel) & ~Fresh;
+    if (!notified.exchange(true))
+    {
+        SDL_Event event{};
+        event.type = engineEvent;
+        SDL_PushEvent(&event);
+    }
+}
+
+void GetBricks(const uint8_t* cells, uint8_t* bricks)
+{
+    std::memset(bricks, 0, ENGINE_BRICKS * ENGINE_BRICKS * ENGINE_BRICKS);
+    for (int z = 0; z < BOUNDS; z++)
+    for (int y = 0; y < BOUNDS; y++)
+    for (int x = 0; x < BOUNDS; x++)
+    {
+        uint8_t& brick = bricks[((z / BRICK) * ENGINE_BRICKS + y / BRICK) * ENGINE_BRICKS + x / BRICK];
+        brick = std::max(brick, cells[GetIndex(x, y, z)]);
+    }
+}
+
+static void UpdateHistory()
+{
+    uint32_t first = 1;
+    uint32_t last = 0;
+    GetHistoryRange(first, last);
+    historyFirst.store(first);
+    historyLast.store(last);
+    historySize.store(GetHistorySize());
+}
+
+static void Run()
+{
+    /* private ping-pong, a published frame may be taken by the reader at any time */
+    static uint8_t cells[2][BOUNDS * BOUNDS * BOUNDS];
+    static int ranges[RANGES][2];
+    int current = 0;
+    uint32_t frame = 0;
+    uint32_t epoch = 0;
+    /* scrubbing keeps the later generations until stepping resumes */
+    bool rewound = false;
+    auto next = std::chrono::steady_clock::now();
+    SetTraceThread("Engine");
+    std::unique_lock lock{mutex};
+    while (running)
+    {
+        SetHistoryBudget(static_cast<size_t>(settings.historyMegabytes) << 20);
+        if (rewinding)
+        {
+            rewinding = false;
+            uint32_t generation = rewindGeneration;
+            if (settings.epoch != epoch)
+            {
+                continue;
+            }
+            lock.unlock();
+            TRACE_SCOPE("Rewind");
+            if (ReadHistory(generation, cells[current]))
+            {
+                frame = generation;
+                rewound = true;
+                EngineFrame& output = frames[writeIndex];
+                std::memcpy(output.cells, cells[current], sizeof(output.cells));
+                GetBricks(output.cells, output.bricks);
+                output.frame = frame;
+                output.epoch = epoch;
+                Publish(output, ranges);
+            }
+            lock.lock();
+            continue;
+        }
+        if (!settings.enabled || (settings.paused && frame != 0 && settings.epoch == epoch))
+        {
+            condition.wait(lock);
+            continue;
+        }
+        if (settings.epoch != epoch)
+        {
+            epoch = settings.epoch;
+            frame = 0;
+            ClearHistory();
+        }
+        /* the seed always goes out immediately */
+        if (frame != 0 && settings.delay > 0.0f)
+        {
+            auto now = std::chrono::steady_clock::now();
+            if (now < next)
+            {
+                condition.wait_until(lock, next);
+                continue;
+            }
+            auto delay = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float, std::milli>(settings.delay));
+            next = std::max(next + delay, now);
+        }
+        Rules rules = settings.rules;
+        rules.frame = frame;
+        lock.unlock();
+        int& minZ = ranges[(frame + 1) % RANGES][0];
+        int& maxZ = ranges[(frame + 1) % RANGES][1];
+        if (rewound)
+        {
+            TruncateHistory(frame);
+            rewound = false;
+        }
+        {
+            TRACE_SCOPE("Step");
+            Step(rules, cells[current], cells[!current], frames[writeIndex].bricks, minZ, maxZ);
+        }
+        current = !current;
+        frame++;
+        {
+            TRACE_SCOPE("History");
+            PushHistory(frame, cells[current], cells[!current]);
+            UpdateHistory();
+        }
+        {
+            TRACE_SCOPE("Publish");
+            EngineFrame& output = frames[writeIndex];
+            std::memcpy(output.cells, cells[current], sizeof(output.cells));
+            output.frame = frame;
+            output.epoch = epoch;
+            Publish(output, ranges);
+        }
+        lock.lock();
+    }
+}
+
+bool StartEngine(uint32_t event)
+{
+    engineEvent = event;
+    running = true;
+    try
+    {
+        thread = std::thread{Run};
+    }
+    catch (const std::system_error& error)
+    {
+        SDL_Log("Failed to create thread: %s", error.what());
+        running = false;
+        return false;
+    }
+    return true;
+}
+
+void StopEngine()
+{
+    {
+        std::lock_guard lock{mutex};
+        running = false;
+    }
+    condition.notify_one();
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+}
+
+void UpdateEngine(const EngineSettings& newSettings)
+{
+    {
+        std::lock_guard lock{mutex};
+        if (settings == newSettings)
+        {
+            return;
+        }
+        settings = newSettings;
+    }
+    condition.notify_one();
+}
+
+void RewindEngine(uint32_t generation)
+{
+    {
+        std::lock_guard lock{mutex};
+        rewinding = true;
+        rewindGeneration = generation;
+    }
+    condition.notify_one();
+}
+
+bool GetEngineHistory(uint32_t& first, uint32_t& last, size_t& size)
+{
+    first = historyFirst.load();
+    last = historyLast.load();
+    size = historySize.load();
+    return first <= last;
+}
+
+const EngineFrame* AcquireEngineFrame()
+{
+    if (!(sharedIndex.load(std::memory_order_relaxed) & Fresh))
+    {
+        return nullptr;
+    }
+    /* cleared first so a frame published after the exchange still sends an event */
+    notified.store(false);
+    readIndex = sharedIndex.exchange(readIndex, std::memory_order_acq_rel) & ~Fresh;
+    const EngineFrame& frame = frames[readIndex];
+    acquired.store(static_cast<uint64_t>(frame.epoch) << 32 | frame.frame, std::memory_order_release);
+    return &frame;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "config.hpp"
+
+#define ENGINE_BRICKS ((BOUNDS + BRICK - 1) / BRICK)
+
+/* matches uniformRules in automata.comp */
+struct Rules
+{
+    uint32_t seed{0};
+    uint32_t surviveMask{16};
+    uint32_t birthMask{96};
+    uint32_t life{32};
+    uint32_t neighborhood{MOORE};
+    uint32_t frame{0};
+
+    bool operator==(const Rules& other) const = default;
+};
+
+struct EngineSettings
+{
+    Rules rules;
+    uint32_t epoch;
+    bool enabled;
+    bool paused;
+    float delay;
+    uint32_t historyMegabytes;
+
+    /* field by field since the padding after the bools isn't set */
+    bool operator==(const EngineSettings& other) const = default;
+};
+
+/* one finished generation, laid out like the textures it is uploaded to */
+struct EngineFrame
+{
+    uint8_t cells[BOUNDS * BOUNDS * BOUNDS];
+    uint8_t bricks[ENGINE_BRICKS * ENGINE_BRICKS * ENGINE_BRICKS];
+    uint32_t frame;
+    uint32_t epoch;
+    /* slices that changed since the previously acquired frame */
+    int minZ;
+    int maxZ;
+};
+
+/* a port of automata.comp, returns the changed slices in minZ and maxZ */
+void Step(const Rules& rules, const uint8_t* inCells, uint8_t* outCells, uint8_t* outBricks, int& minZ, int& maxZ);
+void GetBricks(const uint8_t* cells, uint8_t* bricks);
+/* the cell rules on their own, for grids of other sizes */
+uint8_t GetSeedCell(uint32_t seed, int x, int y, int z);
+uint8_t GetNextCell(const Rules& rules, uint8_t cell, uint32_t neighbors);
+
+bool StartEngine(uint32_t event);
+void StopEngine();
+void UpdateEngine(const EngineSettings& settings);
+const EngineFrame* AcquireEngineFrame();
+void RewindEngine(uint32_t generation);
+bool GetEngineHistory(uint32_t& first, uint32_t& last, size_t& size);
\ No newline at end of file
@@ -0,0 +1,117 @@
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "config.hpp"
+#include "delta.hpp"
+#include "history.hpp"
+
+struct Entry
+{
+    uint32_t generation;
+    bool keyframe;
+    std::vector<uint8_t> data;
+};
+
+static std::deque<Entry> entries;
+static size_t budget;
+static size_t size;
+
+static void Evict()
+{
+    /* a segment is a keyframe and its deltas, the newest one always stays */
+    while (size > budget)
+    {
+        size_t count = 1;
+        while (count < entries.size() && !entries[count].keyframe)
+        {
+            count++;
+        }
+        if (count == entries.size())
+        {
+            break;
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            size -= entries.front().data.size();
+            entries.pop_front();
+        }
+    }
+}
+
+void SetHistoryBudget(size_t bytes)
+{
+    budget = bytes;
+    Evict();
+}
+
+void ClearHistory()
+{
+    entries.clear();
+    size = 0;
+}
+
+void PushHistory(uint32_t generation, const uint8_t* cells, const uint8_t* previous)
+{
+    if (!budget)
+    {
+        ClearHistory();
+        return;
+    }
+    if (!entries.empty() && entries.back().generation + 1 != generation)
+    {
+        /* a gap can't be bridged by deltas */
+        ClearHistory();
+    }
+    Entry& entry = entries.emplace_back();
+    entry.generation = generation;
+    entry.keyframe = entries.size() == 1 || generation % HISTORY_KEYFRAME == 0;
+    EncodeDelta(cells, entry.keyframe ? nullptr : previous, entry.data);
+    size += entry.data.size();
+    Evict();
+}
+
+void TruncateHistory(uint32_t generation)
+{
+    while (!entries.empty() && entries.back().generation > generation)
+    {
+        size -= entries.back().data.size();
+        entries.pop_back();
+    }
+}
+
+bool ReadHistory(uint32_t generation, uint8_t* cells)
+{
+    if (entries.empty() || generation < entries.front().generation || generation > entries.back().generation)
+    {
+        return false;
+    }
+    size_t index = generation - entries.front().generation;
+    size_t keyframe = index;
+    while (!entries[keyframe].keyframe)
+    {
+        keyframe--;
+    }
+    for (size_t i = keyframe; i <= index; i++)
+    {
+        DecodeDelta(entries[i].data.data(), entries[i].data.size(), cells, entries[i].keyframe);
+    }
+    return true;
+}
+
+bool GetHistoryRange(uint32_t& first, uint32_t& last)
+{
+    if (entries.empty())
+    {
+        return false;
+    }
+    first = entries.front().generation;
+    last = entries.back().generation;
+    return true;
+}
+
+size_t GetHistorySize()
+{
+    return size;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* keyframes plus xor deltas of the cells, each run-length encoded and
+ * evicted oldest segment first once over budget, not thread safe */
+void SetHistoryBudget(size_t bytes);
+void ClearHistory();
+void PushHistory(uint32_t generation, const uint8_t* cells, const uint8_t* previous);
+void TruncateHistory(uint32_t generation);
+bool ReadHistory(uint32_t generation, uint8_t* cells);
+bool GetHistoryRange(uint32_t& first, uint32_t& last);
+size_t GetHistorySize();
\ No newline at end of file
@@ -8,64 +8,248 @@
 #include <imgui_impl_sdlgpu3.h>
 
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <iterator>
 
+#include "capture.hpp"
 #include "config.hpp"
+#include "engine.hpp"
+#include "profiler.hpp"
+#include "publisher.hpp"
+#include "readback.hpp"
+#include "recorder.hpp"
+#include "server.hpp"
+#include "slab.hpp"
+#include "snapshot.hpp"
+#include "stream.hpp"
+#include "trace.hpp"
 #include "shader.hpp"
+#include "voxel.hpp"
+#include "world.hpp"
 
 static_assert(BOUNDS < 1024);
-static_assert(FRAMES == 2, "not implemented");
+static_assert(FRAMES >= 3, "the renderer keeps a frame the simulation can't write");
+
+static constexpr int GetLevelSize(int level)
+{
+    int size = BOUNDS;
+    for (int i = 0; i <= level; i++)
+    {
+        size = (size + BRICK - 1) / BRICK;
+    }
+    return size;
+}
+
+static_assert(GetLevelSize(LEVELS - 1) == 1, "occupancy pyramid must reduce to one texel");
+static_assert(LODS == 3, "render.vert binds one texture per lod");
+static_assert(BRICK % (1 << (LODS - 1)) == 0, "a brick must hold whole blocks of every lod");
+
+static constexpr int GetLodSize(int lod)
+{
+    return (BOUNDS + (1 << lod) - 1) >> lod;
+}
+
+static_assert(GetLevelSize(0) == ENGINE_BRICKS);
+
+static constexpr int GetBrickCount()
+{
+    return GetLevelSize(0) * GetLevelSize(0) * GetLevelSize(0);
+}
 
 static SDL_Window* window;
 static SDL_GPUDevice* device;
+static SDL_GPUTextureFormat colorFormat;
 static SDL_GPUGraphicsPipeline* graphicsPipeline;
+static SDL_GPUGraphicsPipeline* splatPipeline;
 static SDL_GPUComputePipeline* computePipeline;
+static SDL_GPUComputePipeline* occupancyPipeline;
+static SDL_GPUComputePipeline* cullPipeline;
+static SDL_GPUComputePipeline* hizPipeline;
+static SDL_GPUComputePipeline* lodPipeline;
 static SDL_GPUTexture* textures[FRAMES];
-static int readFrame{0};
-static int writeFrame{1};
+static SDL_GPUTexture* occupancyTextures[FRAMES][LEVELS];
+static SDL_GPUTexture* lodTextures[FRAMES][LODS];
+static int drawFrame;
+static int headFrame;
+static uint32_t drawGeneration;
+static bool uploadFailed;
 static SDL_GPUBuffer* vertexBuffer;
-static SDL_GPUBuffer* instanceBuffer;
+static SDL_GPUBuffer* brickBuffer;
+static SDL_GPUBuffer* indirectBuffer;
+static SDL_GPUTransferBuffer* indirectTransferBuffer;
+static SDL_GPUBuffer* visibilityBuffer;
 static SDL_GPUTexture* depthTexture;
 static int depthTextureWidth;
 static int depthTextureHeight;
+static SDL_GPUSampler* depthSampler;
+static SDL_GPUTexture* hizTexture;
+static glm::ivec4 hizLevels[HIZ_LEVELS];
+static int hizLevelCount;
 static float pitch;
 static float yaw;
 static float distance{256.0f};
 static uint64_t time1;
 static uint64_t time2;
-static float delta;
 static float delay{10.0f};
+static float budget{4.0f};
+static float accumulator;
+static float generationCost;
+static uint64_t retireTime;
+static uint64_t generationsTime;
+static uint32_t generationsFrame;
+static float generationsPerSecond;
 static bool imguiFocused;
+static bool splat;
+static bool paused;
+static int redraws{REDRAWS};
 
-struct
+enum
 {
-    uint32_t seed{0};
-    uint32_t surviveMask{16};
-    uint32_t birthMask{96};
-    uint32_t life{32};
-    uint32_t neighborhood{MOORE};
-    uint32_t frame{0};
-}
-static rules;
+    CLOCK_FIXED,
+    CLOCK_BUDGET,
+    CLOCK_UNCAPPED,
+};
+
+static int clockMode{CLOCK_FIXED};
+
+enum
+{
+    ENGINE_GPU,
+    ENGINE_CPU,
+};
+
+/* the cpu engine runs on its own thread and its frames are uploaded */
+static int engine{ENGINE_GPU};
+static uint32_t epoch;
+static SDL_GPUTransferBuffer* cellTransferBuffer;
+static int historyMegabytes{HISTORY_MEGABYTES};
+static char snapshotPath[256]{"snapshot.ca3d"};
+static bool loading;
+
+/* replaying a recording uploads its frames instead of simulating */
+static char recordingPath[256]{"recording.ca3r"};
+static bool replaying;
+static bool replayLoading;
+static uint32_t replayIndex;
+static uint32_t replayTarget;
+
+/* generations published into shared memory for other processes */
+static char publishPath[256]{"/ca3d"};
+static bool publishPacked;
+
+/* streaming generations to viewers, or viewing another instance instead of simulating */
+static int streamPort{7777};
+static char viewAddress[256]{"localhost:7777"};
+static uint32_t frameEvent;
+
+/* rendering to files without a window, orbiting the camera by degrees per frame */
+static bool headless;
+static char renderPath[256];
+static int renderWidth{1280};
+static int renderHeight{720};
+static int renderFrames{300};
+static int renderSteps{1};
+static int renderFps{CAPTURE_FPS};
+static float renderOrbit{0.5f};
+static SDL_GPUTexture* renderTexture;
+
+/* running jobs from a control socket without a window, back to back on one device */
+static char serverPath[256];
+static Job job;
+static bool serving;
+static bool cancelled;
+
+/* stepping a grid file too big for memory without a device */
+static char slabPath[256];
+static uint32_t slabSize{1024};
+static uint32_t slabGenerations{SLAB_STEPS};
+
+/* stepping an unbounded world without a device, paging still chunks out to a file */
+static char worldPath[256];
+static uint32_t worldSize{256};
+static uint32_t worldGenerations{1000};
+static uint32_t worldMegabytes{WORLD_MEGABYTES};
+
+/* jumping to a generation on the gpu without drawing the scene */
+static bool fastForward;
+static uint32_t fastForwardTarget{50000};
+static uint32_t fastForwardStart;
+static uint64_t fastForwardTime;
+static uint64_t fastForwardDrawTime;
+
+enum
+{
+    STALL_NOTHING,
+    STALL_LOG,
+    STALL_PAUSE,
+    STALL_RESEED,
+};
+
+/* filled by automata.comp and read back when a batch retires */
+struct Stats
+{
+    uint32_t live;
+    uint32_t changed;
+};
+
+static SDL_GPUBuffer* statsBuffer;
+static SDL_GPUTransferBuffer* statsClearBuffer;
+static SDL_GPUTransferBuffer* statsTransferBuffer;
+static Stats stats;
+static int stallAction{STALL_LOG};
+static bool stalled;
+
+enum
+{
+    PHASE_VISIBLE,
+    PHASE_DISOCCLUDED,
+    PHASE_COUNT,
+};
+
+/* in flight generations, oldest first */
+struct Batch
+{
+    SDL_GPUFence* fence;
+    int frame;
+    int generations;
+    uint64_t time;
+    uint32_t epoch;
+    uint32_t generation;
+    int readbacks;
+};
+
+static Batch batches[FRAMES];
+static int batchCount;
+
+static Rules rules;
 
 static bool Init()
 {
     SDL_SetAppMetadata("3D Cellular Automata", nullptr, nullptr);
     SDL_SetLogPriorities(SDL_LOG_PRIORITY_VERBOSE);
+    if (headless)
+    {
+        /* still loads vulkan (or a software driver like lavapipe) without a display */
+        SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "offscreen");
+    }
     if (!SDL_Init(SDL_INIT_VIDEO))
     {
         SDL_Log("Failed to initialize SDL: %s", SDL_GetError());
         return false;
     }
-    window = SDL_CreateWindow("3D Cellular Automata", 960, 720, SDL_WINDOW_RESIZABLE);
-    if (!window)
+    if (!headless)
     {
-        SDL_Log("Failed to create window: %s", SDL_GetError());
-        return false;
+        window = SDL_CreateWindow("3D Cellular Automata", 960, 720, SDL_WINDOW_RESIZABLE);
+        if (!window)
+        {
+            SDL_Log("Failed to create window: %s", SDL_GetError());
+            return false;
+        }
     }
 #if defined(SDL_PLATFORM_WIN32)
     device = SDL_CreateGPUDevice(SDL_GPU_SHADERFORMAT_DXIL, true, nullptr);
@@ -79,17 +263,23 @@ static bool Init()
         SDL_Log("Failed to create device: %s", SDL_GetError());
         return false;
     }
+    if (headless)
+    {
+        colorFormat = SDL_GPU_TEXTUREFORMAT_R8G8B8A8_UNORM;
+        return true;
+    }
     if (!SDL_ClaimWindowForGPUDevice(device, window))
     {
         SDL_Log("Failed to create swapchain: %s", SDL_GetError());
         return false;
     }
+    colorFormat = SDL_GetGPUSwapchainTextureFormat(device, window);
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     ImGui_ImplSDL3_InitForSDLGPU(window);
     ImGui_ImplSDLGPU3_InitInfo info{};
     info.Device = device;
-    info.ColorTargetFormat = SDL_GetGPUSwapchainTextureFormat(device, window);
+    info.ColorTargetFormat = colorFormat;
     ImGui_ImplSDLGPU3_Init(&info);
     return true;
 }
@@ -97,49 +287,38 @@ static bool Init()
 static bool CreatePipelines()
 {
     SDL_GPUShader* vertShader = LoadShader(device, "render.vert");
+    SDL_GPUShader* splatShader = LoadShader(device, "splat.vert");
     SDL_GPUShader* fragShader = LoadShader(device, "render.frag");
-    if (!vertShader || !fragShader)
+    if (!vertShader || !splatShader || !fragShader)
     {
         SDL_Log("Failed to load shader(s)");
         return false;
     }
-    SDL_GPUVertexBufferDescription buffers[2] =
+    SDL_GPUVertexBufferDescription buffers[1] =
     {{
         .slot = 0,
         .pitch = sizeof(float) * 3,
         .input_rate = SDL_GPU_VERTEXINPUTRATE_VERTEX,
         .instance_step_rate = 0,
-    },
-    {
-        .slot = 1,
-        .pitch = sizeof(uint32_t),
-        .input_rate = SDL_GPU_VERTEXINPUTRATE_INSTANCE,
-        .instance_step_rate = 0,
     }};
-    SDL_GPUVertexAttribute attribs[2] =
+    SDL_GPUVertexAttribute attribs[1] =
     {{
         .location = 0,
         .buffer_slot = 0,
         .format = SDL_GPU_VERTEXELEMENTFORMAT_FLOAT3,
         .offset = 0,
-    },
-    {
-        .location = 1,
-        .buffer_slot = 1,
-        .format = SDL_GPU_VERTEXELEMENTFORMAT_UINT,
-        .offset = 0,
     }};
     SDL_GPUColorTargetDescription targets[1] =
     {{
-        .format = SDL_GetGPUSwapchainTextureFormat(device, window),
+        .format = colorFormat,
     }};
     SDL_GPUGraphicsPipelineCreateInfo info{};
     info.vertex_shader = vertShader;
     info.fragment_shader = fragShader;
     info.vertex_input_state.vertex_buffer_descriptions = buffers;
-    info.vertex_input_state.num_vertex_buffers = 2;
+    info.vertex_input_state.num_vertex_buffers = 1;
     info.vertex_input_state.vertex_attributes = attribs;
-    info.vertex_input_state.num_vertex_attributes = 2;
+    info.vertex_input_state.num_vertex_attributes = 1;
     info.target_info.color_target_descriptions = targets;
     info.target_info.num_color_targets = 1;
     info.target_info.depth_stencil_format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT;
@@ -148,13 +327,20 @@ static bool CreatePipelines()
     info.depth_stencil_state.enable_depth_test = true;
     info.depth_stencil_state.enable_depth_write = true;
     graphicsPipeline = SDL_CreateGPUGraphicsPipeline(device, &info);
+    info.vertex_shader = splatShader;
+    splatPipeline = SDL_CreateGPUGraphicsPipeline(device, &info);
     computePipeline = LoadComputePipeline(device, "automata.comp");
-    if (!graphicsPipeline || !computePipeline)
+    occupancyPipeline = LoadComputePipeline(device, "occupancy.comp");
+    cullPipeline = LoadComputePipeline(device, "cull.comp");
+    hizPipeline = LoadComputePipeline(device, "hiz.comp");
+    lodPipeline = LoadComputePipeline(device, "lod.comp");
+    if (!graphicsPipeline || !splatPipeline || !computePipeline || !occupancyPipeline || !cullPipeline || !hizPipeline || !lodPipeline)
     {
         SDL_Log("Failed to create pipeline(s): %s", SDL_GetError());
         return false;
     }
     SDL_ReleaseGPUShader(device, vertShader);
+    SDL_ReleaseGPUShader(device, splatShader);
     SDL_ReleaseGPUShader(device, fragShader);
     return true;
 }
@@ -192,9 +378,36 @@ static bool CreateResources()
             SDL_Log("Failed to create texture: %s", SDL_GetError());
             return false;
         }
+        /* the first lod is the cells themselves */
+        lodTextures[i][0] = textures[i];
+        for (int j = 1; j < LODS; j++)
+        {
+            info.width = GetLodSize(j);
+            info.height = GetLodSize(j);
+            info.layer_count_or_depth = GetLodSize(j);
+            lodTextures[i][j] = SDL_CreateGPUTexture(device, &info);
+            if (!lodTextures[i][j])
+            {
+                SDL_Log("Failed to create texture: %s", SDL_GetError());
+                return false;
+            }
+        }
+        for (int j = 0; j < LEVELS; j++)
+        {
+            info.width = GetLevelSize(j);
+            info.height = GetLevelSize(j);
+            info.layer_count_or_depth = GetLevelSize(j);
+            occupancyTextures[i][j] = SDL_CreateGPUTexture(device, &info);
+            if (!occupancyTextures[i][j])
+            {
+                SDL_Log("Failed to create texture: %s", SDL_GetError());
+                return false;
+            }
+        }
     }
     {
-        float vertices[36 * 3] =
+        /* a cube followed by a quad for splats */
+        float vertices[(36 + 6) * 3] =
         {
            -0.5f,-0.5f, 0.5f,
             0.5f,-0.5f, 0.5f,
@@ -232,6 +445,12 @@ static bool CreateResources()
            -0.5f,-0.5f,-0.5f,
             0.5f,-0.5f,-0.5f,
             0.5f,-0.5f, 0.5f,
+           -0.5f,-0.5f, 0.0f,
+            0.5f,-0.5f, 0.0f,
+            0.5f, 0.5f, 0.0f,
+           -0.5f,-0.5f, 0.0f,
+            0.5f, 0.5f, 0.0f,
+           -0.5f, 0.5f, 0.0f,
         };
         SDL_GPUTransferBuffer* transferBuffer;
         {
@@ -272,166 +491,136 @@ static bool CreateResources()
         SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
     }
     {
-        SDL_GPUTransferBuffer* transferBuffer;
+        SDL_GPUBufferCreateInfo info{};
+        info.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE | SDL_GPU_BUFFERUSAGE_GRAPHICS_STORAGE_READ;
+        info.size = GetBrickCount() * sizeof(uint32_t) * PHASE_COUNT * LODS;
+        brickBuffer = SDL_CreateGPUBuffer(device, &info);
+        if (!brickBuffer)
         {
-            SDL_GPUTransferBufferCreateInfo info{};
-            info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
-            info.size = BOUNDS * BOUNDS * BOUNDS * sizeof(uint32_t);
-            transferBuffer = SDL_CreateGPUTransferBuffer(device, &info);
-            if (!transferBuffer)
-            {
-                SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
-                return 1;
-            }
+            SDL_Log("Failed to create buffer: %s", SDL_GetError());
+            return false;
         }
-        uint32_t* data = static_cast<uint32_t*>(SDL_MapGPUTransferBuffer(device, transferBuffer, false));
-        if (!data)
+    }
+    {
+        SDL_GPUBufferCreateInfo info{};
+        info.usage = SDL_GPU_BUFFERUSAGE_INDIRECT | SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+        info.size = sizeof(SDL_GPUIndirectDrawCommand) * PHASE_COUNT * LODS;
+        indirectBuffer = SDL_CreateGPUBuffer(device, &info);
+        if (!indirectBuffer)
         {
-            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            SDL_Log("Failed to create buffer: %s", SDL_GetError());
             return false;
         }
+    }
+    {
+        /* contents don't matter, a stale bit only moves a brick between phases */
+        SDL_GPUBufferCreateInfo info{};
+        info.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+        info.size = GetBrickCount() * sizeof(uint32_t);
+        visibilityBuffer = SDL_CreateGPUBuffer(device, &info);
+        if (!visibilityBuffer)
         {
-            SDL_GPUBufferCreateInfo info{};
-            info.usage = SDL_GPU_BUFFERUSAGE_VERTEX;
-            info.size = BOUNDS * BOUNDS * BOUNDS * sizeof(uint32_t);
-            instanceBuffer = SDL_CreateGPUBuffer(device, &info);
-            if (!instanceBuffer)
-            {
-                SDL_Log("Failed to create buffer: %s", SDL_GetError());
-                return false;
-            }
+            SDL_Log("Failed to create buffer: %s", SDL_GetError());
+            return false;
         }
-        uint32_t i = 0;
-        for (int x = 0; x < BOUNDS; x++)
-        for (int y = 0; y < BOUNDS; y++)
-        for (int z = 0; z < BOUNDS; z++)
+    }
+    {
+        SDL_GPUSamplerCreateInfo info{};
+        info.min_filter = SDL_GPU_FILTER_NEAREST;
+        info.mag_filter = SDL_GPU_FILTER_NEAREST;
+        info.mipmap_mode = SDL_GPU_SAMPLERMIPMAPMODE_NEAREST;
+        info.address_mode_u = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
+        info.address_mode_v = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
+        info.address_mode_w = SDL_GPU_SAMPLERADDRESSMODE_CLAMP_TO_EDGE;
+        depthSampler = SDL_CreateGPUSampler(device, &info);
+        if (!depthSampler)
         {
-            data[i] = 0;
-            data[i] |= x << 0;
-            data[i] |= y << 10;
-            data[i] |= z << 20;
-            i++;
+            SDL_Log("Failed to create sampler: %s", SDL_GetError());
+            return false;
         }
-        SDL_GPUTransferBufferLocation location{};
-        SDL_GPUBufferRegion region{};
-        location.transfer_buffer = transferBuffer;
-        region.buffer = instanceBuffer;
-        region.size = BOUNDS * BOUNDS * BOUNDS * sizeof(uint32_t);
-        SDL_UploadToGPUBuffer(copyPass, &location, &region, false);
-        SDL_ReleaseGPUTransferBuffer(device, transferBuffer);
     }
-    SDL_EndGPUCopyPass(copyPass);
-    SDL_SubmitGPUCommandBuffer(commandBuffer);
-    return true;
-}
-
-static void DrawImGui()
-{
-    ImGui_ImplSDLGPU3_NewFrame();
-    ImGui::NewFrame();
-    ImGui::Begin("Settings");
-    imguiFocused = ImGui::IsWindowFocused();
-    if (ImGui::Button("Reset"))
     {
-        rules.seed = std::rand() % RAND_MAX;
-        rules.frame = 0;
+        /* uploaded every frame to reset the instance counts before culling */
+        SDL_GPUTransferBufferCreateInfo info{};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        info.size = sizeof(SDL_GPUIndirectDrawCommand) * PHASE_COUNT * LODS;
+        indirectTransferBuffer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!indirectTransferBuffer)
+        {
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            return false;
+        }
     }
-    ImGui::SliderFloat("Speed", &delay, 0.0f, 1000.0f);
-    ImGui::Text("Survive");
-    for (int i = 1; i < 27; i++)
     {
-        bool bit = (rules.surviveMask >> i) & 1;
-        if (i % 7 == 0)
+        SDL_GPUBufferCreateInfo info{};
+        info.usage = SDL_GPU_BUFFERUSAGE_COMPUTE_STORAGE_WRITE;
+        info.size = sizeof(Stats);
+        statsBuffer = SDL_CreateGPUBuffer(device, &info);
+        if (!statsBuffer)
         {
-            ImGui::NewLine();
+            SDL_Log("Failed to create buffer: %s", SDL_GetError());
+            return false;
         }
-        ImGui::PushID(i);
-        if (ImGui::Checkbox("", &bit))
+    }
+    {
+        /* zeros uploaded before the last generation of a batch */
+        SDL_GPUTransferBufferCreateInfo info{};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        info.size = sizeof(Stats);
+        statsClearBuffer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!statsClearBuffer)
         {
-            if (bit)
-            {
-                rules.surviveMask |= (1 << i);
-            }
-            else
-            {
-                rules.surviveMask &= ~(1 << i);
-            }
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            return false;
         }
-        ImGui::SameLine();
-        ImGui::Text("%02d", i);
-        ImGui::SameLine();
-        ImGui::PopID();
+        void* data = SDL_MapGPUTransferBuffer(device, statsClearBuffer, false);
+        if (!data)
+        {
+            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+        std::memset(data, 0, sizeof(Stats));
+        SDL_UnmapGPUTransferBuffer(device, statsClearBuffer);
     }
-    ImGui::NewLine();
-    ImGui::Text("Birth");
-    for (int i = 1; i < 27; i++)
     {
-        bool bit = (rules.birthMask >> i) & 1;
-        if (i % 7 == 0)
+        /* one slot per frame since in flight batches never share a frame */
+        SDL_GPUTransferBufferCreateInfo info{};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+        info.size = sizeof(Stats) * FRAMES;
+        statsTransferBuffer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!statsTransferBuffer)
         {
-            ImGui::NewLine();
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            return false;
         }
-        ImGui::PushID(32 + i);
-        if (ImGui::Checkbox("", &bit))
+    }
+    {
+        SDL_GPUTransferBufferCreateInfo info{};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_UPLOAD;
+        info.size = sizeof(EngineFrame::cells) + sizeof(EngineFrame::bricks);
+        cellTransferBuffer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!cellTransferBuffer)
         {
-            if (bit)
-            {
-                rules.birthMask |= (1 << i);
-            }
-            else
-            {
-                rules.birthMask &= ~(1 << i);
-            }
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            return false;
         }
-        ImGui::SameLine();
-        ImGui::Text("%02d", i);
-        ImGui::SameLine();
-        ImGui::PopID();
     }
-    ImGui::NewLine();
-    int life = rules.life;
-    int neighborhood = rules.neighborhood;
-    ImGui::SliderInt("Life", &life, 1, 64);
-    ImGui::Text("Neighborhood");
-    ImGui::RadioButton("Moore", &neighborhood, 0);
-    ImGui::RadioButton("Von Neumann", &neighborhood, 1);
-    rules.life = life;
-    rules.neighborhood = neighborhood;
-    ImGui::End();
-    ImGui::Render();
+    SDL_EndGPUCopyPass(copyPass);
+    SDL_SubmitGPUCommandBuffer(commandBuffer);
+    return true;
 }
 
-static void Draw()
+static bool CreateDepthTextures(int width, int height)
 {
-    SDL_WaitForGPUSwapchain(device, window);
-    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
-    if (!commandBuffer)
-    {
-        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
-        return;
-    }
-    SDL_GPUTexture* texture;
-    uint32_t width;
-    uint32_t height;
-    if (!SDL_AcquireGPUSwapchainTexture(commandBuffer, window, &texture, &width, &height))
-    {
-        SDL_Log("Failed to acquire swapchain texture: %s", SDL_GetError());
-        SDL_CancelGPUCommandBuffer(commandBuffer);
-        return;
-    }
-    if (!texture || !width || !height)
-    {
-        /* happens on minimize */
-        SDL_SubmitGPUCommandBuffer(commandBuffer);
-        return;
-    }
-    if (width != depthTextureWidth || height != depthTextureHeight)
+    SDL_ReleaseGPUTexture(device, depthTexture);
+    SDL_ReleaseGPUTexture(device, hizTexture);
+    depthTexture = nullptr;
+    hizTexture = nullptr;
     {
-        SDL_ReleaseGPUTexture(device, depthTexture);
         SDL_GPUTextureCreateInfo info{};
         info.type = SDL_GPU_TEXTURETYPE_2D;
         info.format = SDL_GPU_TEXTUREFORMAT_D32_FLOAT;
-        info.usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET;
+        info.usage = SDL_GPU_TEXTUREUSAGE_DEPTH_STENCIL_TARGET | SDL_GPU_TEXTUREUSAGE_SAMPLER;
         info.width = width;
         info.height = height;
         info.layer_count_or_depth = 1;
@@ -443,108 +632,1570 @@ static void Draw()
         if (!depthTexture)
         {
             SDL_Log("Failed to create texture: %s", SDL_GetError());
-            SDL_SubmitGPUCommandBuffer(commandBuffer);
-            return;
+            return false;
         }
-        depthTextureWidth = width;
-        depthTextureHeight = height;
     }
-    glm::vec3 vector;
-    vector.x = std::cos(pitch) * std::cos(yaw);
-    vector.y = std::sin(pitch);
-    vector.z = std::cos(pitch) * std::sin(yaw);
-    float ratio = static_cast<float>(width) / height;
-    glm::vec3 center = glm::vec3{BOUNDS / 2};
-    glm::vec3 position = center - vector * distance;
-    glm::mat4 view = glm::lookAt(position, position + vector, glm::vec3{0.0f, 1.0f, 0.0f});
-    glm::mat4 proj = glm::perspective(FOV, ratio, NEAR, FAR);
-    glm::mat4 viewProjMatrix = proj * view;
-    ImGuiIO& io = ImGui::GetIO();
-    io.DisplaySize.x = width;
-    io.DisplaySize.y = height;
-    DrawImGui();
-    ImDrawData* drawData = ImGui::GetDrawData();
-    ImGui_ImplSDLGPU3_PrepareDrawData(drawData, commandBuffer);
+    /* the first level sits on the left and the rest are stacked on the right */
+    int atlasWidth = 0;
+    int atlasHeight = 0;
+    int levelWidth = width;
+    int levelHeight = height;
+    hizLevelCount = 0;
+    while (hizLevelCount < HIZ_LEVELS && (levelWidth > 1 || levelHeight > 1))
     {
-        SDL_GPUColorTargetInfo colorInfo{};
-        SDL_GPUDepthStencilTargetInfo depthInfo{};
-        colorInfo.texture = texture;
-        colorInfo.load_op = SDL_GPU_LOADOP_CLEAR;
-        colorInfo.store_op = SDL_GPU_STOREOP_STORE;
-        depthInfo.texture = depthTexture;
-        depthInfo.load_op = SDL_GPU_LOADOP_CLEAR;
-        depthInfo.stencil_load_op = SDL_GPU_LOADOP_CLEAR;
-        depthInfo.store_op = SDL_GPU_STOREOP_STORE;
-        depthInfo.clear_depth = 1.0f;
-        depthInfo.cycle = true;
-        SDL_GPURenderPass* renderPass = SDL_BeginGPURenderPass(commandBuffer, &colorInfo, 1, &depthInfo);
-        if (!renderPass)
+        levelWidth = std::max(1, levelWidth / 2);
+        levelHeight = std::max(1, levelHeight / 2);
+        glm::ivec4& level = hizLevels[hizLevelCount];
+        if (hizLevelCount == 0)
         {
-            SDL_Log("Failed to begin render pass: %s", SDL_GetError());
-            SDL_SubmitGPUCommandBuffer(commandBuffer);
-            return;
+            level = glm::ivec4{0, 0, levelWidth, levelHeight};
         }
-        SDL_BindGPUGraphicsPipeline(renderPass, graphicsPipeline);
-        SDL_GPUBufferBinding vertexBuffers[2]{};
-        vertexBuffers[0].buffer = vertexBuffer;
-        vertexBuffers[1].buffer = instanceBuffer;
-        /* TODO: read or write, which is better? */
-        SDL_BindGPUVertexBuffers(renderPass, 0, vertexBuffers, 2);
-        SDL_BindGPUVertexStorageTextures(renderPass, 0, &textures[writeFrame], 1);
-        SDL_PushGPUVertexUniformData(commandBuffer, 0, &viewProjMatrix, sizeof(viewProjMatrix));
-        SDL_PushGPUFragmentUniformData(commandBuffer, 0, &rules, sizeof(rules));
-        SDL_DrawGPUPrimitives(renderPass, 36, BOUNDS * BOUNDS * BOUNDS, 0, 0);
-        SDL_EndGPURenderPass(renderPass);
-    }
-    {
-        SDL_GPUColorTargetInfo info{};
-        info.texture = texture;
-        info.load_op = SDL_GPU_LOADOP_LOAD;
-        info.store_op = SDL_GPU_STOREOP_STORE;
-        SDL_GPURenderPass* renderPass = SDL_BeginGPURenderPass(commandBuffer, &info, 1, nullptr);
-        if (!renderPass)
+        else if (hizLevelCount == 1)
         {
-            SDL_Log("Failed to begin render pass: %s", SDL_GetError());
-            SDL_SubmitGPUCommandBuffer(commandBuffer);
-            return;
+            level = glm::ivec4{hizLevels[0].z, 0, levelWidth, levelHeight};
         }
-        ImGui_ImplSDLGPU3_RenderDrawData(drawData, commandBuffer, renderPass);
-        SDL_EndGPURenderPass(renderPass);
+        else
+        {
+            const glm::ivec4& previous = hizLevels[hizLevelCount - 1];
+            level = glm::ivec4{previous.x, previous.y + previous.w, levelWidth, levelHeight};
+        }
+        atlasWidth = std::max(atlasWidth, level.x + level.z);
+        atlasHeight = std::max(atlasHeight, level.y + level.w);
+        hizLevelCount++;
     }
-    SDL_SubmitGPUCommandBuffer(commandBuffer);
+    SDL_GPUTextureCreateInfo info{};
+    info.type = SDL_GPU_TEXTURETYPE_2D;
+    info.format = SDL_GPU_TEXTUREFORMAT_R32_FLOAT;
+    info.usage = SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_READ | SDL_GPU_TEXTUREUSAGE_COMPUTE_STORAGE_WRITE;
+    info.width = std::max(1, atlasWidth);
+    info.height = std::max(1, atlasHeight);
+    info.layer_count_or_depth = 1;
+    info.num_levels = 1;
+    hizTexture = SDL_CreateGPUTexture(device, &info);
+    if (!hizTexture)
+    {
+        SDL_Log("Failed to create texture: %s", SDL_GetError());
+        return false;
+    }
+    return true;
 }
 
-static void Simulate()
+static void GetFrustum(const glm::mat4& matrix, glm::vec4 planes[6])
 {
-    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
-    if (!commandBuffer)
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++)
     {
-        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
-        return;
+        rows[i] = glm::vec4{matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]};
     }
-    SDL_GPUStorageTextureReadWriteBinding textureBinding{};
-    textureBinding.texture = textures[writeFrame];
-    SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &textureBinding, 1, nullptr, 0);
-    if (!computePass)
+    planes[0] = rows[3] + rows[0];
+    planes[1] = rows[3] - rows[0];
+    planes[2] = rows[3] + rows[1];
+    planes[3] = rows[3] - rows[1];
+    planes[4] = rows[2];
+    planes[5] = rows[3] - rows[2];
+}
+
+static void StopReplay()
+{
+    CloseReplay();
+    replaying = false;
+}
+
+static void Reset()
+{
+    if (replaying)
     {
-        SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
-        SDL_SubmitGPUCommandBuffer(commandBuffer);
-        return;
+        StopReplay();
     }
-    SDL_BindGPUComputePipeline(computePass, computePipeline);
-    SDL_PushGPUComputeUniformData(commandBuffer, 0, &rules, sizeof(rules));
-    SDL_BindGPUComputeStorageTextures(computePass, 0, &textures[readFrame], 1);
-    int groups = (BOUNDS + THREADS - 1) / THREADS;
-    SDL_DispatchGPUCompute(computePass, groups, groups, groups);
-    SDL_EndGPUComputePass(computePass);
-    SDL_SubmitGPUCommandBuffer(commandBuffer);
-    readFrame = (readFrame + 1) % FRAMES;
-    writeFrame = (writeFrame + 1) % FRAMES;
-    rules.frame++;
+    StopViewing();
+    rules.seed = std::rand() % RAND_MAX;
+    rules.frame = 0;
+    epoch++;
+    stalled = false;
 }
 
-int main(int argc, char** argv)
+static void FastForward(uint32_t target)
 {
+    /* the cpu or replayed frame is already on the gpu so the gpu engine picks it up */
+    if (replaying)
+    {
+        StopReplay();
+    }
+    StopViewing();
+    engine = ENGINE_GPU;
+    if (target < rules.frame)
+    {
+        /* same seed, from the start */
+        rules.frame = 0;
+        epoch++;
+    }
+    fastForward = true;
+    fastForwardTarget = target;
+    fastForwardStart = rules.frame;
+    fastForwardTime = SDL_GetTicksNS();
+    fastForwardDrawTime = 0;
+}
+
+static void Upload(const EngineFrame& frame);
+static bool Retire();
+static void ReportBatch(const Batch& batch);
+
+static bool HasExtension(const char* path, const char* extension)
+{
+    size_t length = std::strlen(path);
+    size_t extensionLength = std::strlen(extension);
+    return length >= extensionLength && !SDL_strcasecmp(path + length - extensionLength, extension);
+}
+
+static void SaveCallback(uint32_t generation, const uint8_t* cells, void* userdata)
+{
+    /* one shot, whichever generation comes back first */
+    RemoveReadbackConsumer(SaveCallback, userdata);
+    Rules saved = rules;
+    saved.frame = generation;
+    if (HasExtension(snapshotPath, ".vox"))
+    {
+        SaveVox(snapshotPath, saved, cells);
+    }
+    else if (HasExtension(snapshotPath, ".xyz"))
+    {
+        SavePoints(snapshotPath, saved, cells);
+    }
+    else
+    {
+        SaveSnapshot(snapshotPath, saved, cells);
+    }
+}
+
+/* for the recorder, the shared memory ring and the viewers */
+static bool IsReadingBackAll()
+{
+    return IsRecording() || IsPublishing() || IsStreaming();
+}
+
+static void Save()
+{
+    if (!AddReadbackConsumer(SaveCallback, nullptr))
+    {
+        return;
+    }
+    /* otherwise the next generation read back gets saved */
+    if (!IsReadingBackAll() || paused || engine == ENGINE_CPU || replaying || IsViewing())
+    {
+        RequestReadback(device, textures[drawFrame], drawGeneration);
+    }
+}
+
+static bool Load(const char* path)
+{
+    static EngineFrame frame;
+    if (replaying)
+    {
+        StopReplay();
+    }
+    /* imports keep the rules and carry on past the seed and the copy */
+    Rules loaded = rules;
+    loaded.frame = 2;
+    bool success;
+    if (HasExtension(path, ".vox"))
+    {
+        success = LoadVox(path, rules.life, frame.cells);
+    }
+    else if (HasExtension(path, ".xyz"))
+    {
+        success = LoadPoints(path, rules.life, frame.cells);
+    }
+    else
+    {
+        success = LoadSnapshot(path, loaded, frame.cells);
+    }
+    if (!success)
+    {
+        return false;
+    }
+    /* in flight batches would retire over the upload */
+    SDL_WaitForGPUIdle(device);
+    Retire();
+    StopViewing();
+    engine = ENGINE_GPU;
+    fastForward = false;
+    stalled = false;
+    rules = loaded;
+    epoch++;
+    GetBricks(frame.cells, frame.bricks);
+    frame.frame = rules.frame;
+    frame.epoch = epoch;
+    frame.minZ = 0;
+    frame.maxZ = BOUNDS - 1;
+    Upload(frame);
+    redraws = REDRAWS;
+    SDL_Log("Loaded generation %u from %s", rules.frame, path);
+    return true;
+}
+
+static void Record()
+{
+    if (IsRecording())
+    {
+        StopRecording();
+    }
+    else if (StartRecording(recordingPath, &rules))
+    {
+        /* starts from what is on screen rather than the next generation */
+        RequestReadback(device, textures[drawFrame], drawGeneration);
+    }
+}
+
+static void Publish()
+{
+    if (IsPublishing())
+    {
+        StopPublishing();
+    }
+    else if (StartPublishing(publishPath, publishPacked, &rules))
+    {
+        RequestReadback(device, textures[drawFrame], drawGeneration);
+    }
+}
+
+static void Stream()
+{
+    if (IsStreaming())
+    {
+        StopStreaming();
+    }
+    else if (StartStreaming(streamPort, &rules))
+    {
+        RequestReadback(device, textures[drawFrame], drawGeneration);
+    }
+}
+
+static void View()
+{
+    if (IsViewing())
+    {
+        StopViewing();
+        return;
+    }
+    if (replaying)
+    {
+        StopReplay();
+    }
+    /* in flight batches would retire over the uploads */
+    SDL_WaitForGPUIdle(device);
+    Retire();
+    engine = ENGINE_GPU;
+    fastForward = false;
+    stalled = false;
+    epoch++;
+    StartViewing(viewAddress, frameEvent);
+}
+
+static void Seek(uint32_t index)
+{
+    static EngineFrame frame;
+    /* with the rules that stepped to it in case they changed while recording */
+    if (!ReadReplay(index, frame.cells, rules))
+    {
+        StopReplay();
+        return;
+    }
+    replayIndex = index;
+    replayTarget = index;
+    GetBricks(frame.cells, frame.bricks);
+    frame.frame = GetReplayGeneration(index);
+    frame.epoch = epoch;
+    frame.minZ = 0;
+    frame.maxZ = BOUNDS - 1;
+    Upload(frame);
+    redraws = std::max(redraws, 1);
+}
+
+static bool Replay(const char* path)
+{
+    Rules replayed;
+    if (!OpenReplay(path, replayed))
+    {
+        return false;
+    }
+    /* in flight batches would retire over the upload */
+    SDL_WaitForGPUIdle(device);
+    Retire();
+    if (IsRecording())
+    {
+        PollReadbacks(device, true);
+        StopRecording();
+    }
+    StopViewing();
+    engine = ENGINE_GPU;
+    fastForward = false;
+    stalled = false;
+    rules = replayed;
+    epoch++;
+    replaying = true;
+    accumulator = 0.0f;
+    Seek(0);
+    SDL_Log("Replaying %u generations from %s", GetReplayLength(), path);
+    return replaying;
+}
+
+static void DrawImGui()
+{
+    PROFILE_SCOPE(PROFILE_IMGUI);
+    ImGui_ImplSDLGPU3_NewFrame();
+    ImGui::NewFrame();
+    ImGui::Begin("Settings");
+    imguiFocused = ImGui::IsWindowFocused();
+    if (ImGui::Button("Reset"))
+    {
+        Reset();
+    }
+    /* the engines don't share state so switching starts over */
+    int previousEngine = engine;
+    ImGui::RadioButton("GPU", &engine, ENGINE_GPU);
+    ImGui::SameLine();
+    ImGui::RadioButton("CPU", &engine, ENGINE_CPU);
+    if (engine != previousEngine)
+    {
+        Reset();
+    }
+    if (engine == ENGINE_CPU)
+    {
+        uint32_t first;
+        uint32_t last;
+        size_t size;
+        if (GetEngineHistory(first, last, size))
+        {
+            uint32_t generation = std::clamp(rules.frame, first, last);
+            if (ImGui::SliderScalar("History", ImGuiDataType_U32, &generation, &first, &last))
+            {
+                /* scrubbing pauses so the rewound generation stays put */
+                paused = true;
+                RewindEngine(generation);
+            }
+        }
+        ImGui::SliderInt("History (MB)", &historyMegabytes, 0, 4096);
+        ImGui::Text("History: %.1f MB", size / 1048576.0f);
+    }
+    ImGui::RadioButton("Fixed", &clockMode, CLOCK_FIXED);
+    ImGui::SameLine();
+    ImGui::RadioButton("Budget", &clockMode, CLOCK_BUDGET);
+    ImGui::SameLine();
+    ImGui::RadioButton("Uncapped", &clockMode, CLOCK_UNCAPPED);
+    switch (clockMode)
+    {
+    case CLOCK_FIXED:
+        ImGui::SliderFloat("Speed", &delay, 0.0f, 1000.0f);
+        break;
+    case CLOCK_BUDGET:
+        ImGui::SliderFloat("Budget (ms)", &budget, 0.1f, 100.0f);
+        break;
+    }
+    ImGui::Checkbox("Paused", &paused);
+    ImGui::InputText("##snapshot", snapshotPath, sizeof(snapshotPath));
+    ImGui::SameLine();
+    if (ImGui::Button("Save"))
+    {
+        Save();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Load"))
+    {
+        /* not in the middle of recording a frame */
+        loading = true;
+    }
+    ImGui::InputText("##recording", recordingPath, sizeof(recordingPath));
+    ImGui::SameLine();
+    if (ImGui::Button(IsRecording() ? "Stop##record" : "Record"))
+    {
+        Record();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button(replaying ? "Stop##replay" : "Replay"))
+    {
+        if (replaying)
+        {
+            StopReplay();
+        }
+        else
+        {
+            replayLoading = true;
+        }
+    }
+    if (IsRecording())
+    {
+        uint32_t generations;
+        uint64_t bytes;
+        GetRecordingStats(generations, bytes);
+        ImGui::Text("Recorded: %u generations, %.1f MB", generations, bytes / 1048576.0f);
+    }
+    ImGui::InputText("##publish", publishPath, sizeof(publishPath));
+    ImGui::SameLine();
+    if (ImGui::Button(IsPublishing() ? "Stop##publish" : "Publish"))
+    {
+        Publish();
+    }
+    ImGui::SameLine();
+    ImGui::BeginDisabled(IsPublishing());
+    ImGui::Checkbox("Packed", &publishPacked);
+    ImGui::EndDisabled();
+    if (IsPublishing())
+    {
+        ImGui::Text("Published: %llu generations", static_cast<unsigned long long>(GetPublishedCount()));
+    }
+    ImGui::InputInt("##port", &streamPort);
+    ImGui::SameLine();
+    if (ImGui::Button(IsStreaming() ? "Stop##stream" : "Stream"))
+    {
+        Stream();
+    }
+    if (IsStreaming())
+    {
+        int viewers;
+        uint64_t bytes;
+        GetStreamingStats(viewers, bytes);
+        ImGui::Text("Streamed: %d viewers, %.1f MB", viewers, bytes / 1048576.0f);
+    }
+    ImGui::InputText("##view", viewAddress, sizeof(viewAddress));
+    ImGui::SameLine();
+    if (ImGui::Button(IsViewing() ? "Stop##view" : "View"))
+    {
+        View();
+    }
+    if (IsViewing())
+    {
+        ImGui::Text("Viewed: %.1f MB", GetViewedBytes() / 1048576.0f);
+    }
+    if (replaying)
+    {
+        uint32_t first = 0;
+        uint32_t last = GetReplayLength() - 1;
+        /* seeks after the frame is drawn */
+        ImGui::SliderScalar("Replay", ImGuiDataType_U32, &replayTarget, &first, &last);
+        ImGui::Text("Generation %u", GetReplayGeneration(replayIndex));
+    }
+    ImGui::Combo("On stall", &stallAction, "Nothing\0Log\0Pause\0Reseed\0");
+    ImGui::Text("Live: %u%s", stats.live, stalled ? " (stalled)" : "");
+    ImGui::Text("Generations/s: %.1f", generationsPerSecond);
+    if (fastForward)
+    {
+        uint32_t done = rules.frame - fastForwardStart;
+        uint32_t total = fastForwardTarget - fastForwardStart;
+        float seconds = (SDL_GetTicksNS() - fastForwardTime) / 1e9f;
+        float eta = done ? seconds / done * (total - done) : 0.0f;
+        ImGui::ProgressBar(total ? static_cast<float>(done) / total : 1.0f);
+        ImGui::Text("Generation %u of %u, %.1f s left", rules.frame, fastForwardTarget, eta);
+        if (ImGui::Button("Cancel"))
+        {
+            fastForward = false;
+        }
+    }
+    else
+    {
+        ImGui::InputScalar("##target", ImGuiDataType_U32, &fastForwardTarget);
+        ImGui::SameLine();
+        if (ImGui::Button("Jump"))
+        {
+            FastForward(fastForwardTarget);
+        }
+    }
+    ImGui::Text("Survive");
+    for (int i = 1; i < 27; i++)
+    {
+        bool bit = (rules.surviveMask >> i) & 1;
+        if (i % 7 == 0)
+        {
+            ImGui::NewLine();
+        }
+        ImGui::PushID(i);
+        if (ImGui::Checkbox("", &bit))
+        {
+            if (bit)
+            {
+                rules.surviveMask |= (1 << i);
+            }
+            else
+            {
+                rules.surviveMask &= ~(1 << i);
+            }
+        }
+        ImGui::SameLine();
+        ImGui::Text("%02d", i);
+        ImGui::SameLine();
+        ImGui::PopID();
+    }
+    ImGui::NewLine();
+    ImGui::Text("Birth");
+    for (int i = 1; i < 27; i++)
+    {
+        bool bit = (rules.birthMask >> i) & 1;
+        if (i % 7 == 0)
+        {
+            ImGui::NewLine();
+        }
+        ImGui::PushID(32 + i);
+        if (ImGui::Checkbox("", &bit))
+        {
+            if (bit)
+            {
+                rules.birthMask |= (1 << i);
+            }
+            else
+            {
+                rules.birthMask &= ~(1 << i);
+            }
+        }
+        ImGui::SameLine();
+        ImGui::Text("%02d", i);
+        ImGui::SameLine();
+        ImGui::PopID();
+    }
+    ImGui::NewLine();
+    int life = rules.life;
+    int neighborhood = rules.neighborhood;
+    ImGui::SliderInt("Life", &life, 1, 64);
+    ImGui::Text("Neighborhood");
+    ImGui::RadioButton("Moore", &neighborhood, 0);
+    ImGui::RadioButton("Von Neumann", &neighborhood, 1);
+    ImGui::Checkbox("Splat", &splat);
+    rules.life = life;
+    rules.neighborhood = neighborhood;
+    PROFILE_DRAW();
+    ImGui::End();
+    ImGui::Render();
+}
+
+/* the scene without the panel, shared by the window and headless rendering */
+static bool DrawScene(SDL_GPUCommandBuffer* commandBuffer, SDL_GPUTexture* texture, uint32_t width, uint32_t height)
+{
+    if (width != depthTextureWidth || height != depthTextureHeight)
+    {
+        if (!CreateDepthTextures(width, height))
+        {
+            return false;
+        }
+        depthTextureWidth = width;
+        depthTextureHeight = height;
+    }
+    glm::vec3 vector;
+    vector.x = std::cos(pitch) * std::cos(yaw);
+    vector.y = std::sin(pitch);
+    vector.z = std::cos(pitch) * std::sin(yaw);
+    float ratio = static_cast<float>(width) / height;
+    glm::vec3 center = glm::vec3{BOUNDS / 2};
+    glm::vec3 position = center - vector * distance;
+    glm::mat4 view = glm::lookAt(position, position + vector, glm::vec3{0.0f, 1.0f, 0.0f});
+    glm::mat4 proj = glm::perspective(FOV, ratio, NEAR, FAR);
+    glm::mat4 viewProjMatrix = proj * view;
+    {
+        SDL_GPUIndirectDrawCommand* data = static_cast<SDL_GPUIndirectDrawCommand*>(SDL_MapGPUTransferBuffer(device, indirectTransferBuffer, true));
+        if (!data)
+        {
+            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+        for (int i = 0; i < PHASE_COUNT * LODS; i++)
+        {
+            data[i] = {};
+            data[i].num_vertices = splat ? 6 : 36;
+        }
+        SDL_UnmapGPUTransferBuffer(device, indirectTransferBuffer);
+        SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+        if (!copyPass)
+        {
+            SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+            return false;
+        }
+        SDL_GPUTransferBufferLocation location{};
+        SDL_GPUBufferRegion region{};
+        location.transfer_buffer = indirectTransferBuffer;
+        region.buffer = indirectBuffer;
+        region.size = sizeof(SDL_GPUIndirectDrawCommand) * PHASE_COUNT * LODS;
+        SDL_UploadToGPUBuffer(copyPass, &location, &region, false);
+        SDL_EndGPUCopyPass(copyPass);
+    }
+    struct
+    {
+        glm::vec4 planes[6];
+        glm::mat4 viewProjMatrix;
+        glm::vec4 camera;
+        glm::ivec4 levels[HIZ_LEVELS];
+        int32_t numLevels;
+        uint32_t phase;
+    }
+    cull;
+    GetFrustum(viewProjMatrix, cull.planes);
+    cull.viewProjMatrix = viewProjMatrix;
+    /* w is the height in pixels of a cell at a distance of one */
+    cull.camera = glm::vec4{position, height * proj[1][1] / 2.0f};
+    std::copy(std::begin(hizLevels), std::end(hizLevels), std::begin(cull.levels));
+    cull.numLevels = hizLevelCount;
+    /* the first phase draws what was visible last frame and the second phase
+     * draws whatever the resulting hiz can't prove is occluded */
+    for (cull.phase = 0; cull.phase < PHASE_COUNT && !fastForward; cull.phase++)
+    {
+        {
+            SDL_GPUStorageBufferReadWriteBinding bufferBindings[3]{};
+            bufferBindings[0].buffer = indirectBuffer;
+            bufferBindings[1].buffer = brickBuffer;
+            bufferBindings[2].buffer = visibilityBuffer;
+            SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, nullptr, 0, bufferBindings, 3);
+            if (!computePass)
+            {
+                SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+                return false;
+            }
+            SDL_GPUTexture* computeTextures[2] = {occupancyTextures[drawFrame][0], hizTexture};
+            SDL_BindGPUComputePipeline(computePass, cullPipeline);
+            SDL_PushGPUComputeUniformData(commandBuffer, 0, &cull, sizeof(cull));
+            SDL_BindGPUComputeStorageTextures(computePass, 0, computeTextures, 2);
+            int groups = (GetLevelSize(0) + THREADS - 1) / THREADS;
+            SDL_DispatchGPUCompute(computePass, groups, groups, groups);
+            SDL_EndGPUComputePass(computePass);
+        }
+        {
+            SDL_GPUColorTargetInfo colorInfo{};
+            SDL_GPUDepthStencilTargetInfo depthInfo{};
+            colorInfo.texture = texture;
+            colorInfo.store_op = SDL_GPU_STOREOP_STORE;
+            depthInfo.texture = depthTexture;
+            depthInfo.store_op = SDL_GPU_STOREOP_STORE;
+            depthInfo.clear_depth = 1.0f;
+            if (cull.phase == PHASE_VISIBLE)
+            {
+                colorInfo.load_op = SDL_GPU_LOADOP_CLEAR;
+                depthInfo.load_op = SDL_GPU_LOADOP_CLEAR;
+                depthInfo.stencil_load_op = SDL_GPU_LOADOP_CLEAR;
+                depthInfo.cycle = true;
+            }
+            else
+            {
+                colorInfo.load_op = SDL_GPU_LOADOP_LOAD;
+                depthInfo.load_op = SDL_GPU_LOADOP_LOAD;
+                depthInfo.stencil_load_op = SDL_GPU_LOADOP_LOAD;
+            }
+            SDL_GPURenderPass* renderPass = SDL_BeginGPURenderPass(commandBuffer, &colorInfo, 1, &depthInfo);
+            if (!renderPass)
+            {
+                SDL_Log("Failed to begin render pass: %s", SDL_GetError());
+                return false;
+            }
+            SDL_GPUBufferBinding vertexBufferBinding{};
+            vertexBufferBinding.buffer = vertexBuffer;
+            if (splat)
+            {
+                SDL_BindGPUGraphicsPipeline(renderPass, splatPipeline);
+                vertexBufferBinding.offset = 36 * sizeof(float) * 3;
+            }
+            else
+            {
+                SDL_BindGPUGraphicsPipeline(renderPass, graphicsPipeline);
+            }
+            /* always a completed generation the simulation won't write to */
+            SDL_BindGPUVertexBuffers(renderPass, 0, &vertexBufferBinding, 1);
+            SDL_BindGPUVertexStorageTextures(renderPass, 0, lodTextures[drawFrame], LODS);
+            SDL_BindGPUVertexStorageBuffers(renderPass, 0, &brickBuffer, 1);
+            SDL_PushGPUVertexUniformData(commandBuffer, 0, &viewProjMatrix, sizeof(viewProjMatrix));
+            SDL_PushGPUFragmentUniformData(commandBuffer, 0, &rules, sizeof(rules));
+            for (uint32_t lod = 0; lod < LODS; lod++)
+            {
+                uint32_t command = cull.phase * LODS + lod;
+                struct
+                {
+                    uint32_t brickOffset;
+                    uint32_t lod;
+                    glm::vec2 splatScale;
+                }
+                draw;
+                draw.brickOffset = command * GetBrickCount();
+                draw.lod = lod;
+                draw.splatScale = glm::vec2{proj[0][0], proj[1][1]};
+                SDL_PushGPUVertexUniformData(commandBuffer, 1, &draw, sizeof(draw));
+                SDL_DrawGPUPrimitivesIndirect(renderPass, indirectBuffer, command * sizeof(SDL_GPUIndirectDrawCommand), 1);
+            }
+            SDL_EndGPURenderPass(renderPass);
+        }
+        if (cull.phase != PHASE_VISIBLE)
+        {
+            continue;
+        }
+        for (int i = 0; i < hizLevelCount; i++)
+        {
+            SDL_GPUStorageTextureReadWriteBinding textureBinding{};
+            textureBinding.texture = hizTexture;
+            SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &textureBinding, 1, nullptr, 0);
+            if (!computePass)
+            {
+                SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+                return false;
+            }
+            struct
+            {
+                glm::ivec4 levels[HIZ_LEVELS];
+                int32_t level;
+            }
+            hiz;
+            std::copy(std::begin(hizLevels), std::end(hizLevels), std::begin(hiz.levels));
+            hiz.level = i;
+            SDL_GPUTextureSamplerBinding samplerBinding{};
+            samplerBinding.texture = depthTexture;
+            samplerBinding.sampler = depthSampler;
+            SDL_BindGPUComputePipeline(computePass, hizPipeline);
+            SDL_PushGPUComputeUniformData(commandBuffer, 0, &hiz, sizeof(hiz));
+            SDL_BindGPUComputeSamplers(computePass, 0, &samplerBinding, 1);
+            int groupsX = (hizLevels[i].z + THREADS - 1) / THREADS;
+            int groupsY = (hizLevels[i].w + THREADS - 1) / THREADS;
+            SDL_DispatchGPUCompute(computePass, groupsX, groupsY, 1);
+            SDL_EndGPUComputePass(computePass);
+        }
+    }
+    return true;
+}
+
+static void Draw()
+{
+    {
+        PROFILE_SCOPE(PROFILE_SWAPCHAIN);
+        SDL_WaitForGPUSwapchain(device, window);
+    }
+    PROFILE_SCOPE(PROFILE_DRAW);
+    TRACE_SCOPE("Draw");
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return;
+    }
+    SDL_GPUTexture* texture;
+    uint32_t width;
+    uint32_t height;
+    if (!SDL_AcquireGPUSwapchainTexture(commandBuffer, window, &texture, &width, &height))
+    {
+        SDL_Log("Failed to acquire swapchain texture: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    if (!texture || !width || !height)
+    {
+        /* happens on minimize */
+        SDL_SubmitGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    ImGuiIO& io = ImGui::GetIO();
+    io.DisplaySize.x = width;
+    io.DisplaySize.y = height;
+    DrawImGui();
+    ImDrawData* drawData = ImGui::GetDrawData();
+    ImGui_ImplSDLGPU3_PrepareDrawData(drawData, commandBuffer);
+    if (!DrawScene(commandBuffer, texture, width, height))
+    {
+        SDL_SubmitGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    {
+        SDL_GPUColorTargetInfo info{};
+        info.texture = texture;
+        info.load_op = fastForward ? SDL_GPU_LOADOP_CLEAR : SDL_GPU_LOADOP_LOAD;
+        info.store_op = SDL_GPU_STOREOP_STORE;
+        SDL_GPURenderPass* renderPass = SDL_BeginGPURenderPass(commandBuffer, &info, 1, nullptr);
+        if (!renderPass)
+        {
+            SDL_Log("Failed to begin render pass: %s", SDL_GetError());
+            SDL_SubmitGPUCommandBuffer(commandBuffer);
+            return;
+        }
+        ImGui_ImplSDLGPU3_RenderDrawData(drawData, commandBuffer, renderPass);
+        SDL_EndGPURenderPass(renderPass);
+    }
+    SDL_SubmitGPUCommandBuffer(commandBuffer);
+}
+
+static bool IsFramePinned(int frame)
+{
+    if (frame == drawFrame)
+    {
+        return true;
+    }
+    for (int i = 0; i < batchCount; i++)
+    {
+        if (batches[i].frame == frame)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int GetFreeFrame(int readFrame)
+{
+    for (int i = 0; i < FRAMES; i++)
+    {
+        if (i != readFrame && !IsFramePinned(i))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int GetCapacity(int generations)
+{
+    /* ping-ponging needs two free frames and a single generation needs one */
+    int frames = 0;
+    for (int i = 0; i < FRAMES; i++)
+    {
+        frames += !IsFramePinned(i);
+    }
+    if (IsReadingBackAll())
+    {
+        int readbacks = GetFreeReadbacks();
+        generations = std::min(generations, readbacks);
+        if (IsRecording())
+        {
+            /* and then leaves room for the writer, which drops what doesn't fit */
+            int queued = READBACKS - readbacks;
+            generations = std::clamp(GetRecordingCapacity() - queued, 0, generations);
+        }
+    }
+    if (frames >= 2)
+    {
+        return generations;
+    }
+    return std::min(generations, frames);
+}
+
+static bool BuildLevels(SDL_GPUCommandBuffer* commandBuffer, int frame)
+{
+    for (int i = 1; i < LEVELS; i++)
+    {
+        SDL_GPUStorageTextureReadWriteBinding textureBinding{};
+        textureBinding.texture = occupancyTextures[frame][i];
+        SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &textureBinding, 1, nullptr, 0);
+        if (!computePass)
+        {
+            SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+            return false;
+        }
+        int size = GetLevelSize(i - 1);
+        SDL_BindGPUComputePipeline(computePass, occupancyPipeline);
+        SDL_PushGPUComputeUniformData(commandBuffer, 0, &size, sizeof(size));
+        SDL_BindGPUComputeStorageTextures(computePass, 0, &occupancyTextures[frame][i - 1], 1);
+        int groups = (size + THREADS - 1) / THREADS;
+        SDL_DispatchGPUCompute(computePass, groups, groups, groups);
+        SDL_EndGPUComputePass(computePass);
+    }
+    for (int i = 1; i < LODS; i++)
+    {
+        SDL_GPUStorageTextureReadWriteBinding textureBinding{};
+        textureBinding.texture = lodTextures[frame][i];
+        SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, &textureBinding, 1, nullptr, 0);
+        if (!computePass)
+        {
+            SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+            return false;
+        }
+        SDL_BindGPUComputePipeline(computePass, lodPipeline);
+        SDL_BindGPUComputeStorageTextures(computePass, 0, &lodTextures[frame][i - 1], 1);
+        int groups = (GetLodSize(i) + THREADS - 1) / THREADS;
+        SDL_DispatchGPUCompute(computePass, groups, groups, groups);
+        SDL_EndGPUComputePass(computePass);
+    }
+    return true;
+}
+
+static void Simulate(int generations)
+{
+    PROFILE_SCOPE(PROFILE_SIMULATE);
+    TRACE_SCOPE("Simulate");
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return;
+    }
+    int readFrame = headFrame;
+    uint32_t frame = rules.frame;
+    for (int i = 0; i < generations; i++)
+    {
+        int writeFrame = GetFreeFrame(readFrame);
+        assert(writeFrame != -1);
+        if (i == generations - 1)
+        {
+            /* only the last generation is checked for a stall */
+            SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+            if (!copyPass)
+            {
+                SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+                SDL_CancelGPUCommandBuffer(commandBuffer);
+                CancelReadbacks();
+                rules.frame = frame;
+                return;
+            }
+            SDL_GPUTransferBufferLocation location{};
+            SDL_GPUBufferRegion region{};
+            location.transfer_buffer = statsClearBuffer;
+            region.buffer = statsBuffer;
+            region.size = sizeof(Stats);
+            SDL_UploadToGPUBuffer(copyPass, &location, &region, false);
+            SDL_EndGPUCopyPass(copyPass);
+        }
+        /* the first occupancy level is reduced by the automata workgroups */
+        SDL_GPUStorageTextureReadWriteBinding textureBindings[2]{};
+        SDL_GPUStorageBufferReadWriteBinding bufferBinding{};
+        textureBindings[0].texture = textures[writeFrame];
+        textureBindings[1].texture = occupancyTextures[writeFrame][0];
+        bufferBinding.buffer = statsBuffer;
+        SDL_GPUComputePass* computePass = SDL_BeginGPUComputePass(commandBuffer, textureBindings, 2, &bufferBinding, 1);
+        if (!computePass)
+        {
+            SDL_Log("Failed to begin compute pass: %s", SDL_GetError());
+            SDL_CancelGPUCommandBuffer(commandBuffer);
+            CancelReadbacks();
+            rules.frame = frame;
+            return;
+        }
+        SDL_BindGPUComputePipeline(computePass, computePipeline);
+        SDL_PushGPUComputeUniformData(commandBuffer, 0, &rules, sizeof(rules));
+        SDL_BindGPUComputeStorageTextures(computePass, 0, &textures[readFrame], 1);
+        int groups = (BOUNDS + THREADS - 1) / THREADS;
+        SDL_DispatchGPUCompute(computePass, groups, groups, groups);
+        SDL_EndGPUComputePass(computePass);
+        readFrame = writeFrame;
+        rules.frame++;
+        if (IsReadingBackAll())
+        {
+            /* ping-ponging overwrites it two generations later */
+            SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+            if (!copyPass)
+            {
+                SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+                SDL_CancelGPUCommandBuffer(commandBuffer);
+                CancelReadbacks();
+                rules.frame = frame;
+                return;
+            }
+            QueueReadback(copyPass, textures[readFrame], rules.frame);
+            SDL_EndGPUCopyPass(copyPass);
+        }
+    }
+    /* only the last generation of a batch gets drawn */
+    if (!BuildLevels(commandBuffer, readFrame))
+    {
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        CancelReadbacks();
+        rules.frame = frame;
+        return;
+    }
+    {
+        SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+        if (!copyPass)
+        {
+            SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+            SDL_CancelGPUCommandBuffer(commandBuffer);
+            CancelReadbacks();
+            rules.frame = frame;
+            return;
+        }
+        SDL_GPUBufferRegion region{};
+        SDL_GPUTransferBufferLocation location{};
+        region.buffer = statsBuffer;
+        region.size = sizeof(Stats);
+        location.transfer_buffer = statsTransferBuffer;
+        location.offset = readFrame * sizeof(Stats);
+        SDL_DownloadFromGPUBuffer(copyPass, &region, &location);
+        SDL_EndGPUCopyPass(copyPass);
+    }
+    SDL_GPUFence* fence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    if (!fence)
+    {
+        SDL_Log("Failed to submit command buffer: %s", SDL_GetError());
+        CancelReadbacks();
+        rules.frame = frame;
+        return;
+    }
+    Batch& batch = batches[batchCount++];
+    batch.fence = fence;
+    batch.frame = readFrame;
+    batch.generations = generations;
+    batch.time = SDL_GetTicksNS();
+    batch.epoch = epoch;
+    batch.generation = rules.frame;
+    batch.readbacks = SubmitReadbacks();
+    headFrame = readFrame;
+    /* queued behind the batch and copied out while later batches run */
+    if (HasReadbackConsumers() && !batch.readbacks)
+    {
+        RequestReadback(device, textures[readFrame], rules.frame);
+    }
+}
+
+static void Upload(const EngineFrame& frame)
+{
+    PROFILE_SCOPE(PROFILE_UPLOAD);
+    TRACE_SCOPE("Upload");
+    if (frame.epoch != epoch)
+    {
+        /* from before a reset */
+        return;
+    }
+    rules.frame = frame.frame;
+    drawGeneration = frame.frame;
+    /* the changed slices are since the last frame, which a failure never sent */
+    int minZ = uploadFailed ? 0 : frame.minZ;
+    int maxZ = uploadFailed ? BOUNDS - 1 : frame.maxZ;
+    uploadFailed = true;
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return;
+    }
+    uint8_t* data = static_cast<uint8_t*>(SDL_MapGPUTransferBuffer(device, cellTransferBuffer, true));
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    /* only the changed slices, the bricks are small enough to always send */
+    int slices = std::max(0, maxZ - minZ + 1);
+    uint32_t offset = slices * BOUNDS * BOUNDS;
+    std::memcpy(data, frame.cells + minZ * BOUNDS * BOUNDS, offset);
+    std::memcpy(data + offset, frame.bricks, sizeof(frame.bricks));
+    SDL_UnmapGPUTransferBuffer(device, cellTransferBuffer);
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    SDL_GPUTextureTransferInfo info{};
+    SDL_GPUTextureRegion region{};
+    info.transfer_buffer = cellTransferBuffer;
+    if (slices)
+    {
+        region.texture = textures[drawFrame];
+        region.z = minZ;
+        region.w = BOUNDS;
+        region.h = BOUNDS;
+        region.d = slices;
+        SDL_UploadToGPUTexture(copyPass, &info, &region, false);
+    }
+    info.offset = offset;
+    region.texture = occupancyTextures[drawFrame][0];
+    region.z = 0;
+    region.w = ENGINE_BRICKS;
+    region.h = ENGINE_BRICKS;
+    region.d = ENGINE_BRICKS;
+    SDL_UploadToGPUTexture(copyPass, &info, &region, false);
+    SDL_EndGPUCopyPass(copyPass);
+    if (!BuildLevels(commandBuffer, drawFrame))
+    {
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return;
+    }
+    SDL_SubmitGPUCommandBuffer(commandBuffer);
+    uploadFailed = false;
+    /* keeps the ring consistent for when the gpu engine takes over */
+    headFrame = drawFrame;
+    /* already on the cpu */
+    DispatchReadback(frame.frame, frame.cells);
+}
+
+static void CheckStats(const Batch& batch)
+{
+    Stats* data = static_cast<Stats*>(SDL_MapGPUTransferBuffer(device, statsTransferBuffer, false));
+    if (!data)
+    {
+        SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+        return;
+    }
+    stats = data[batch.frame];
+    SDL_UnmapGPUTransferBuffer(device, statsTransferBuffer);
+    /* the seed and the copy after it aren't steps of the rule */
+    if (batch.epoch != epoch || batch.generation < 3)
+    {
+        return;
+    }
+    if (stats.live && stats.changed)
+    {
+        stalled = false;
+        return;
+    }
+    if (stalled)
+    {
+        return;
+    }
+    stalled = true;
+    const char* reason = stats.live ? "Stagnated" : "Extinct";
+    switch (fastForward ? STALL_LOG : stallAction)
+    {
+    case STALL_LOG:
+        SDL_Log("%s at generation %u", reason, batch.generation);
+        break;
+    case STALL_PAUSE:
+        SDL_Log("%s at generation %u, pausing", reason, batch.generation);
+        paused = true;
+        break;
+    case STALL_RESEED:
+        SDL_Log("%s at generation %u, reseeding", reason, batch.generation);
+        Reset();
+        break;
+    }
+}
+
+static bool Retire()
+{
+    bool retired = false;
+    while (batchCount && SDL_QueryGPUFence(device, batches[0].fence))
+    {
+        /* batches run back to back so only count from the previous one's end */
+        uint64_t time = SDL_GetTicksNS();
+        float cost = (time - std::max(batches[0].time, retireTime)) / 1e6f / batches[0].generations;
+        PROFILE_TIME(PROFILE_GPU, time - std::max(batches[0].time, retireTime));
+        /* from when the gpu could have started it until it was seen finished */
+        AddTraceEvent("Batch", std::max(batches[0].time, retireTime), time, TRACK_GPU);
+        if (generationCost > 0.0f)
+        {
+            generationCost = std::lerp(generationCost, cost, 0.1f);
+        }
+        else
+        {
+            generationCost = cost;
+        }
+        retireTime = time;
+        drawFrame = batches[0].frame;
+        drawGeneration = batches[0].generation;
+        SignalReadbacks(batches[0].readbacks);
+        CheckStats(batches[0]);
+        if (serving)
+        {
+            ReportBatch(batches[0]);
+        }
+        /* an extinct or stagnant grid looks the same as the frame already drawn */
+        retired = retired || stats.changed || batches[0].generation < 3;
+        SDL_ReleaseGPUFence(device, batches[0].fence);
+        std::copy(batches + 1, batches + batchCount, batches);
+        batchCount--;
+    }
+    return retired;
+}
+
+static int Schedule(float delta)
+{
+    int capacity = GetCapacity(GENERATIONS);
+    if (paused)
+    {
+        /* still seed after a reset */
+        accumulator = 0.0f;
+        return std::min<int>(rules.frame == 0, capacity);
+    }
+    int generations = 0;
+    switch (clockMode)
+    {
+    case CLOCK_FIXED:
+        if (delay <= 0.0f)
+        {
+            accumulator = 0.0f;
+            return std::min(1, capacity);
+        }
+        accumulator += delta;
+        if (accumulator > GENERATIONS * delay)
+        {
+            /* drop the backlog instead of spiraling */
+            accumulator = GENERATIONS * delay;
+        }
+        generations = std::min(static_cast<int>(accumulator / delay), capacity);
+        accumulator -= generations * delay;
+        return generations;
+    case CLOCK_BUDGET:
+    case CLOCK_UNCAPPED:
+        if (generationCost <= 0.0f)
+        {
+            return std::min(1, capacity);
+        }
+        if (clockMode == CLOCK_BUDGET)
+        {
+            generations = static_cast<int>(budget / generationCost);
+        }
+        else
+        {
+            generations = static_cast<int>(delta / generationCost);
+        }
+        return std::clamp(generations, std::min(1, capacity), capacity);
+    }
+    return 0;
+}
+
+static int GetIdleTimeout()
+{
+    if (fastForward)
+    {
+        return 0;
+    }
+    if (replaying && !paused)
+    {
+        return std::max(0, static_cast<int>(std::ceil(delay - accumulator)));
+    }
+    /* nothing signals a batch retiring, so poll until the last one has been drawn */
+    if (batchCount)
+    {
+        return 1;
+    }
+    /* the engine and viewer threads push an event for every frame, and a
+     * stalled grid has nothing to step until something wakes it */
+    if (paused || stalled || engine == ENGINE_CPU || IsViewing())
+    {
+        return -1;
+    }
+    if (clockMode == CLOCK_FIXED && delay > 0.0f)
+    {
+        return std::max(1, static_cast<int>(std::ceil(delay - accumulator)));
+    }
+    return 0;
+}
+
+static void RunHeadless()
+{
+    SDL_GPUTextureCreateInfo info{};
+    info.type = SDL_GPU_TEXTURETYPE_2D;
+    info.format = colorFormat;
+    info.usage = SDL_GPU_TEXTUREUSAGE_COLOR_TARGET;
+    info.width = renderWidth;
+    info.height = renderHeight;
+    info.layer_count_or_depth = 1;
+    info.num_levels = 1;
+    renderTexture = SDL_CreateGPUTexture(device, &info);
+    if (!renderTexture)
+    {
+        SDL_Log("Failed to create texture: %s", SDL_GetError());
+        return;
+    }
+    if (!StartCapture(device, renderPath, renderWidth, renderHeight, renderFps))
+    {
+        return;
+    }
+    /* starts from the seed, a loaded grid or --generation */
+    uint32_t target = std::max<uint32_t>(rules.frame, 1);
+    if (fastForward)
+    {
+        target = fastForwardTarget;
+        fastForward = false;
+    }
+    uint64_t logTime = SDL_GetTicksNS();
+    for (int i = 0; i < renderFrames; i++)
+    {
+        bool failed = false;
+        while (rules.frame != target && !failed)
+        {
+            int generations = GetCapacity(std::min<uint32_t>(target - rules.frame, FAST_FORWARD));
+            if (generations)
+            {
+                uint32_t frame = rules.frame;
+                Simulate(generations);
+                failed = rules.frame == frame;
+            }
+            else
+            {
+                SDL_WaitForGPUFences(device, true, &batches[0].fence, 1);
+                Retire();
+            }
+            PollReadbacks(device, false);
+        }
+        /* the frame drawn is the last one simulated */
+        while (batchCount)
+        {
+            SDL_WaitForGPUFences(device, true, &batches[0].fence, 1);
+            Retire();
+        }
+        if (failed)
+        {
+            break;
+        }
+        SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+        if (!commandBuffer)
+        {
+            SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+            break;
+        }
+        if (!DrawScene(commandBuffer, renderTexture, renderWidth, renderHeight))
+        {
+            SDL_SubmitGPUCommandBuffer(commandBuffer);
+            break;
+        }
+        SDL_SubmitGPUCommandBuffer(commandBuffer);
+        if (!RequestCapture(device, renderTexture))
+        {
+            break;
+        }
+        PollCaptures(device, false);
+        PollReadbacks(device, false);
+        yaw += glm::radians(renderOrbit);
+        target = rules.frame + renderSteps;
+        uint64_t time = SDL_GetTicksNS();
+        if (time - logTime >= 1000000000)
+        {
+            SDL_Log("Rendered frame %d of %d at generation %u", i + 1, renderFrames, drawGeneration);
+            logTime = time;
+        }
+        FlushTrace(false);
+    }
+    StopCapture(device);
+    SDL_Log("Rendered to %s", renderPath);
+}
+
+/* the stats of every batch ending on a report */
+static void ReportBatch(const Batch& batch)
+{
+    if (batch.epoch != epoch || !job.every || batch.generation % job.every || batch.generation == job.generations)
+    {
+        return;
+    }
+    if (!ReportJob(job, batch.generation, stats.live, stats.changed))
+    {
+        cancelled = true;
+    }
+}
+
+static bool RunGpuJob()
+{
+    rules = job.rules;
+    rules.frame = 0;
+    epoch++;
+    stalled = false;
+    stats = {};
+    serving = true;
+    bool failed = false;
+    while (rules.frame != job.generations && !failed && !cancelled)
+    {
+        /* batches end on every report so its stats get read back */
+        uint32_t target = job.generations;
+        if (job.every)
+        {
+            target = std::min(target, (rules.frame / job.every + 1) * job.every);
+        }
+        int generations = GetCapacity(std::min<uint32_t>(target - rules.frame, FAST_FORWARD));
+        if (generations)
+        {
+            uint32_t frame = rules.frame;
+            Simulate(generations);
+            failed = rules.frame == frame;
+        }
+        else
+        {
+            SDL_WaitForGPUFences(device, true, &batches[0].fence, 1);
+            Retire();
+        }
+        PollReadbacks(device, false);
+    }
+    while (batchCount)
+    {
+        SDL_WaitForGPUFences(device, true, &batches[0].fence, 1);
+        Retire();
+    }
+    serving = false;
+    if (failed || cancelled || !job.snapshot[0])
+    {
+        return !failed;
+    }
+    SDL_strlcpy(snapshotPath, job.snapshot, sizeof(snapshotPath));
+    if (AddReadbackConsumer(SaveCallback, nullptr))
+    {
+        RequestReadback(device, textures[drawFrame], drawGeneration);
+        PollReadbacks(device, true);
+    }
+    return true;
+}
+
+static void RunCpuJob()
+{
+    static EngineFrame frames[2];
+    int read = 0;
+    Rules stepped = job.rules;
+    for (uint32_t frame = 0; frame < job.generations && !cancelled; frame++)
+    {
+        stepped.frame = frame;
+        int minZ;
+        int maxZ;
+        Step(stepped, frames[read].cells, frames[1 - read].cells, frames[1 - read].bricks, minZ, maxZ);
+        read = 1 - read;
+        uint32_t generation = frame + 1;
+        stats.changed = minZ <= maxZ;
+        if (generation == job.generations || (job.every && generation % job.every == 0))
+        {
+            const uint8_t* cells = frames[read].cells;
+            stats.live = std::count_if(cells, cells + BOUNDS * BOUNDS * BOUNDS, [](uint8_t value) { return value > 0; });
+            if (generation != job.generations && !ReportJob(job, generation, stats.live, stats.changed))
+            {
+                cancelled = true;
+            }
+        }
+    }
+    if (!cancelled && job.snapshot[0])
+    {
+        rules = job.rules;
+        SDL_strlcpy(snapshotPath, job.snapshot, sizeof(snapshotPath));
+        SaveCallback(job.generations, frames[read].cells, nullptr);
+    }
+}
+
+static void RunServer()
+{
+    if (!StartServer(serverPath))
+    {
+        return;
+    }
+    /* a job runs to its generation count whatever happens */
+    stallAction = STALL_NOTHING;
+    while (WaitForJob(job))
+    {
+        TRACE_SCOPE("Job");
+        uint64_t start = SDL_GetTicksNS();
+        cancelled = false;
+        if (job.cpu)
+        {
+            RunCpuJob();
+        }
+        else if (!RunGpuJob())
+        {
+            FailJob(job, "Failed to simulate");
+            continue;
+        }
+        float seconds = (SDL_GetTicksNS() - start) / 1e9f;
+        if (cancelled)
+        {
+            SDL_Log("Job %u cancelled", job.id);
+            continue;
+        }
+        FinishJob(job, job.generations, stats.live, stats.changed, seconds);
+        SDL_Log("Job %u: %u generations on the %s in %.2f s", job.id, job.generations, job.cpu ? "cpu" : "gpu", seconds);
+        FlushTrace(false);
+    }
+    StopServer();
+}
+
+static bool RunSlab()
+{
+    /* seeded the first time, then stepped a pass at a time into a second file
+     * that replaces the first so an interrupted run loses at most one pass */
+    if (!SDL_GetPathInfo(slabPath, nullptr) && !CreateSlabGrid(slabPath, slabSize, rules))
+    {
+        return false;
+    }
+    char next[sizeof(slabPath) + 8];
+    SDL_snprintf(next, sizeof(next), "%s.next", slabPath);
+    for (uint32_t generation = 0; generation < slabGenerations; generation += SLAB_STEPS)
+    {
+        int steps = std::min<uint32_t>(SLAB_STEPS, slabGenerations - generation);
+        if (!StepSlabGrid(slabPath, next, steps))
+        {
+            return false;
+        }
+        if (!SDL_RenamePath(next, slabPath))
+        {
+            SDL_Log("Failed to rename %s: %s", next, SDL_GetError());
+            return false;
+        }
+        FlushTrace(false);
+    }
+    return true;
+}
+
+static bool RunWorld()
+{
+    if (!CreateWorld(worldPath, worldSize, rules, static_cast<size_t>(worldMegabytes) << 20))
+    {
+        DestroyWorld();
+        return false;
+    }
+    bool failed = false;
+    uint64_t time = SDL_GetTicksNS();
+    uint64_t logTime = time;
+    for (uint32_t generation = 1; generation <= worldGenerations && !failed; generation++)
+    {
+        failed = !StepWorld();
+        FlushTrace(false);
+        uint64_t now = SDL_GetTicksNS();
+        if (now - logTime < 1000000000 && generation != worldGenerations)
+        {
+            continue;
+        }
+        logTime = now;
+        WorldStats world;
+        GetWorldStats(world);
+        SDL_Log("Generation %u: %llu live cells, %zu chunks stepped, %zu resident and %zu paged out (%llu in, %llu out)",
+            world.frame, static_cast<unsigned long long>(world.live), world.stepped, world.resident, world.paged,
+            static_cast<unsigned long long>(world.pageIns), static_cast<unsigned long long>(world.pageOuts));
+    }
+    float seconds = (SDL_GetTicksNS() - time) / 1e9f;
+    SDL_Log("Stepped %u generations in %.2f s", worldGenerations, seconds);
+    DestroyWorld();
+    return !failed;
+}
+
+int main(int argc, char** argv)
+{
+    /* known before init since there's no window to create */
+    SetTraceThread("Main");
+    bool seeded = false;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--render") || !std::strcmp(argv[i], "--server"))
+        {
+            headless = true;
+        }
+        else if (!std::strcmp(argv[i], "--slab"))
+        {
+            SDL_strlcpy(slabPath, argv[i + 1], sizeof(slabPath));
+        }
+        else if (!std::strcmp(argv[i], "--slab-size"))
+        {
+            slabSize = std::max(3l, std::strtol(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--slab-generations"))
+        {
+            slabGenerations = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--world"))
+        {
+            SDL_strlcpy(worldPath, argv[i + 1], sizeof(worldPath));
+        }
+        else if (!std::strcmp(argv[i], "--world-size"))
+        {
+            worldSize = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--world-generations"))
+        {
+            worldGenerations = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--world-megabytes"))
+        {
+            worldMegabytes = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--seed"))
+        {
+            rules.seed = std::strtoul(argv[i + 1], nullptr, 10);
+            seeded = true;
+        }
+        else if (!std::strcmp(argv[i], "--trace"))
+        {
+            /* also traces the slab and world runs */
+            StartTrace(argv[i + 1]);
+        }
+    }
+    /* the windowed path seeds after init, which this exits before */
+    if ((slabPath[0] || worldPath[0]) && !seeded)
+    {
+        std::srand(std::time(nullptr));
+        rules.seed = std::rand() % RAND_MAX;
+    }
+    if (slabPath[0] || worldPath[0])
+    {
+        bool ran = slabPath[0] ? RunSlab() : RunWorld();
+        StopTrace();
+        return ran ? 0 : 1;
+    }
     if (!Init())
     {
         SDL_Log("Failed to initialize");
@@ -560,73 +2211,350 @@ int main(int argc, char** argv)
         SDL_Log("Failed to create resources");
         return 1;
     }
+    if (!CreateReadbacks(device))
+    {
+        SDL_Log("Failed to create readbacks");
+        return 1;
+    }
     std::srand(std::time(nullptr));
     rules.seed = std::rand() % RAND_MAX;
-    bool running = true;
+    frameEvent = SDL_RegisterEvents(1);
+    if (!StartEngine(frameEvent))
+    {
+        SDL_Log("Failed to start engine");
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!std::strcmp(argv[i], "--seed"))
+        {
+            rules.seed = std::strtoul(argv[i + 1], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--load"))
+        {
+            Load(argv[i + 1]);
+        }
+        else if (!std::strcmp(argv[i], "--record"))
+        {
+            SDL_strlcpy(recordingPath, argv[i + 1], sizeof(recordingPath));
+            Record();
+        }
+        else if (!std::strcmp(argv[i], "--replay"))
+        {
+            SDL_strlcpy(recordingPath, argv[i + 1], sizeof(recordingPath));
+            Replay(recordingPath);
+        }
+        else if (!std::strcmp(argv[i], "--publish") || !std::strcmp(argv[i], "--publish-packed"))
+        {
+            SDL_strlcpy(publishPath, argv[i + 1], sizeof(publishPath));
+            publishPacked = !std::strcmp(argv[i], "--publish-packed");
+            Publish();
+        }
+        else if (!std::strcmp(argv[i], "--serve"))
+        {
+            streamPort = std::strtol(argv[i + 1], nullptr, 10);
+            Stream();
+        }
+        else if (!std::strcmp(argv[i], "--view"))
+        {
+            SDL_strlcpy(viewAddress, argv[i + 1], sizeof(viewAddress));
+            View();
+        }
+        else if (!std::strcmp(argv[i], "--generation"))
+        {
+            FastForward(std::strtoul(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--render"))
+        {
+            SDL_strlcpy(renderPath, argv[i + 1], sizeof(renderPath));
+        }
+        else if (!std::strcmp(argv[i], "--server"))
+        {
+            SDL_strlcpy(serverPath, argv[i + 1], sizeof(serverPath));
+        }
+        else if (!std::strcmp(argv[i], "--size"))
+        {
+            char* end;
+            renderWidth = std::max(1l, std::strtol(argv[i + 1], &end, 10));
+            if (*end == 'x')
+            {
+                renderHeight = std::max(1l, std::strtol(end + 1, nullptr, 10));
+            }
+        }
+        else if (!std::strcmp(argv[i], "--frames"))
+        {
+            renderFrames = std::strtol(argv[i + 1], nullptr, 10);
+        }
+        else if (!std::strcmp(argv[i], "--steps"))
+        {
+            renderSteps = std::max(1l, std::strtol(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--orbit"))
+        {
+            renderOrbit = std::strtof(argv[i + 1], nullptr);
+        }
+        else if (!std::strcmp(argv[i], "--fps"))
+        {
+            renderFps = std::max(1l, std::strtol(argv[i + 1], nullptr, 10));
+        }
+        else if (!std::strcmp(argv[i], "--slab") || !std::strcmp(argv[i], "--slab-size") ||
+            !std::strcmp(argv[i], "--slab-generations") || !std::strncmp(argv[i], "--world", 7))
+        {
+            /* handled before init */
+        }
+        else
+        {
+            SDL_Log("Unknown argument: %s", argv[i]);
+        }
+    }
+    if (serverPath[0])
+    {
+        RunServer();
+    }
+    else if (headless)
+    {
+        RunHeadless();
+    }
+    bool running = !headless;
     while (running)
     {
-        time2 = SDL_GetTicks();
-        delta += time2 - time1;
+        if (!redraws)
+        {
+            /* nothing to present so sleep until an event or the next generation */
+            int timeout = GetIdleTimeout();
+            if (timeout)
+            {
+                SDL_WaitEventTimeout(nullptr, timeout);
+            }
+        }
+        time2 = SDL_GetTicksNS();
+        float delta = (time2 - time1) / 1e6f;
         time1 = time2;
-        SDL_Event event;
-        while (SDL_PollEvent(&event))
+        if (time2 - generationsTime >= 1000000000)
+        {
+            /* a reset rewinds the frame */
+            generationsPerSecond = std::max(0.0f, static_cast<float>(rules.frame) - generationsFrame) * 1e9f / (time2 - generationsTime);
+            generationsTime = time2;
+            generationsFrame = rules.frame;
+        }
         {
-            ImGui_ImplSDL3_ProcessEvent(&event);
-            switch (event.type)
+            PROFILE_SCOPE(PROFILE_EVENTS);
+            SDL_Event event;
+            while (SDL_PollEvent(&event))
             {
-            case SDL_EVENT_QUIT:
-                running = false;
-                break;
-            case SDL_EVENT_MOUSE_MOTION:
-                if (!imguiFocused && event.motion.state & SDL_BUTTON_LMASK)
-                {
-                    yaw += event.motion.xrel * PAN;
-                    pitch -= event.motion.yrel * PAN;
-                    float clamp = glm::pi<float>() / 2.0f - 0.01f;
-                    pitch = std::clamp(pitch, -clamp, clamp);
-                }
-                break;
-            case SDL_EVENT_MOUSE_WHEEL:
-                // if (!imguiFocused)
-                {
-                    distance -= event.wheel.y * ZOOM;
-                    distance = std::max(1.0f, distance);
-                }
-                break;
-            case SDL_EVENT_KEY_DOWN:
-                if (event.key.scancode == SDL_SCANCODE_R)
+                ImGui_ImplSDL3_ProcessEvent(&event);
+                redraws = REDRAWS;
+                switch (event.type)
                 {
-                    rules.seed = std::rand() % RAND_MAX;
-                    rules.frame = 0;
+                case SDL_EVENT_QUIT:
+                    running = false;
+                    break;
+                case SDL_EVENT_MOUSE_MOTION:
+                    if (!imguiFocused && event.motion.state & SDL_BUTTON_LMASK)
+                    {
+                        yaw += event.motion.xrel * PAN;
+                        pitch -= event.motion.yrel * PAN;
+                        float clamp = glm::pi<float>() / 2.0f - 0.01f;
+                        pitch = std::clamp(pitch, -clamp, clamp);
+                    }
+                    break;
+                case SDL_EVENT_MOUSE_WHEEL:
+                    // if (!imguiFocused)
+                    {
+                        distance -= event.wheel.y * ZOOM;
+                        distance = std::max(1.0f, distance);
+                    }
+                    break;
+                case SDL_EVENT_KEY_DOWN:
+                    if (event.key.scancode == SDL_SCANCODE_R)
+                    {
+                        Reset();
+                    }
+                    else if (event.key.scancode == SDL_SCANCODE_SPACE)
+                    {
+                        paused = !paused;
+                    }
+                    else if (event.key.scancode == SDL_SCANCODE_T)
+                    {
+                        if (IsTracing())
+                        {
+                            StopTrace();
+                        }
+                        else
+                        {
+                            StartTrace("trace.json");
+                        }
+                    }
+                    break;
                 }
-                break;
             }
         }
         if (!running)
         {
             break;
         }
-        Draw();
-        if (delta < delay)
+        if (Retire())
         {
-            continue;
+            redraws = std::max(redraws, 1);
+        }
+        {
+            PROFILE_SCOPE(PROFILE_READBACK);
+            TRACE_SCOPE("Readback");
+            PollReadbacks(device, false);
+        }
+        if (loading)
+        {
+            loading = false;
+            Load(snapshotPath);
+        }
+        if (replayLoading)
+        {
+            replayLoading = false;
+            Replay(recordingPath);
+        }
+        if (replaying)
+        {
+            if (!paused && replayTarget + 1 < GetReplayLength())
+            {
+                /* paced like the fixed clock whatever the clock mode */
+                accumulator += delta;
+                if (accumulator >= delay)
+                {
+                    accumulator = 0.0f;
+                    replayTarget++;
+                }
+            }
+            if (replayTarget != replayIndex)
+            {
+                Seek(replayTarget);
+            }
+        }
+        if (IsViewing())
+        {
+            Rules viewed;
+            if (EngineFrame* frame = AcquireViewedFrame(viewed))
+            {
+                rules = viewed;
+                frame->epoch = epoch;
+                Upload(*frame);
+                redraws = std::max(redraws, 1);
+            }
+            else if (!IsViewerConnected())
+            {
+                StopViewing();
+            }
+        }
+        EngineSettings settings{};
+        settings.rules = rules;
+        settings.epoch = epoch;
+        settings.enabled = engine == ENGINE_CPU && !replaying && !IsViewing();
+        settings.paused = paused;
+        settings.delay = clockMode == CLOCK_FIXED ? delay : 0.0f;
+        settings.historyMegabytes = historyMegabytes;
+        UpdateEngine(settings);
+        if (engine == ENGINE_CPU && !replaying && !IsViewing() && !batchCount)
+        {
+            /* wait for gpu batches so they can't retire over an upload */
+            if (const EngineFrame* frame = AcquireEngineFrame())
+            {
+                Upload(*frame);
+                redraws = std::max(redraws, 1);
+            }
+        }
+        if (fastForward && rules.frame == fastForwardTarget && !batchCount)
+        {
+            fastForward = false;
+            accumulator = 0.0f;
+            redraws = REDRAWS;
+        }
+        if (fastForward)
+        {
+            /* only the panel, to show progress */
+            if (time2 - fastForwardDrawTime >= FAST_FORWARD_INTERVAL * 1000000ull)
+            {
+                Draw();
+                fastForwardDrawTime = time2;
+            }
+        }
+        else if (redraws > 0)
+        {
+            Draw();
+            redraws--;
         }
-        delta = 0.0f;
-        Simulate();
+        int generations = 0;
+        if (fastForward)
+        {
+            generations = GetCapacity(std::min<uint32_t>(fastForwardTarget - rules.frame, FAST_FORWARD));
+            if (!generations && batchCount && rules.frame != fastForwardTarget)
+            {
+                /* sleep on the oldest batch instead of spinning */
+                SDL_WaitForGPUFences(device, true, &batches[0].fence, 1);
+            }
+        }
+        else if (engine == ENGINE_GPU && !replaying && !IsViewing())
+        {
+            generations = Schedule(delta);
+        }
+        if (generations > 0)
+        {
+            Simulate(generations);
+        }
+        PROFILE_FRAME(generationsPerSecond);
+        FlushTrace(false);
     }
+    StopEngine();
+    StopTrace();
+    SDL_WaitForGPUIdle(device);
+    Retire();
+    PollReadbacks(device, true);
+    StopRecording();
+    StopPublishing();
+    StopStreaming();
+    StopViewing();
+    CloseReplay();
+    ReleaseReadbacks(device);
     for (int i = 0; i < FRAMES; i++)
     {
         SDL_ReleaseGPUTexture(device, textures[i]);
+        for (int j = 0; j < LEVELS; j++)
+        {
+            SDL_ReleaseGPUTexture(device, occupancyTextures[i][j]);
+        }
+        for (int j = 1; j < LODS; j++)
+        {
+            SDL_ReleaseGPUTexture(device, lodTextures[i][j]);
+        }
     }
     SDL_ReleaseGPUTexture(device, depthTexture);
+    SDL_ReleaseGPUTexture(device, hizTexture);
+    SDL_ReleaseGPUTexture(device, renderTexture);
+    SDL_ReleaseGPUSampler(device, depthSampler);
+    SDL_ReleaseGPUBuffer(device, visibilityBuffer);
     SDL_ReleaseGPUBuffer(device, vertexBuffer);
-    SDL_ReleaseGPUBuffer(device, instanceBuffer);
-    ImGui_ImplSDLGPU3_Shutdown();
-    ImGui_ImplSDL3_Shutdown();
-    ImGui::DestroyContext();
+    SDL_ReleaseGPUBuffer(device, brickBuffer);
+    SDL_ReleaseGPUBuffer(device, indirectBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, indirectTransferBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, cellTransferBuffer);
+    SDL_ReleaseGPUBuffer(device, statsBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, statsClearBuffer);
+    SDL_ReleaseGPUTransferBuffer(device, statsTransferBuffer);
+    if (!headless)
+    {
+        ImGui_ImplSDLGPU3_Shutdown();
+        ImGui_ImplSDL3_Shutdown();
+        ImGui::DestroyContext();
+    }
     SDL_ReleaseGPUGraphicsPipeline(device, graphicsPipeline);
+    SDL_ReleaseGPUGraphicsPipeline(device, splatPipeline);
     SDL_ReleaseGPUComputePipeline(device, computePipeline);
-    SDL_ReleaseWindowFromGPUDevice(device, window);
+    SDL_ReleaseGPUComputePipeline(device, occupancyPipeline);
+    SDL_ReleaseGPUComputePipeline(device, cullPipeline);
+    SDL_ReleaseGPUComputePipeline(device, hizPipeline);
+    SDL_ReleaseGPUComputePipeline(device, lodPipeline);
+    if (window)
+    {
+        SDL_ReleaseWindowFromGPUDevice(device, window);
+    }
     SDL_DestroyGPUDevice(device);
     SDL_DestroyWindow(window);
     SDL_Quit();
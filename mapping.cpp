@@ -0,0 +1,104 @@
+#include <SDL3/SDL.h>
+
+#if defined(SDL_PLATFORM_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mapping.hpp"
+
+#if defined(SDL_PLATFORM_WIN32)
+
+bool MapFile(const char* path, Mapping& mapping)
+{
+    mapping = {};
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        SDL_Log("Failed to open %s: %lu", path, GetLastError());
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || !size.QuadPart)
+    {
+        SDL_Log("Failed to get the size of %s", path);
+        CloseHandle(file);
+        return false;
+    }
+    /* the mapping keeps the file open */
+    HANDLE handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!handle)
+    {
+        SDL_Log("Failed to map %s: %lu", path, GetLastError());
+        return false;
+    }
+    void* data = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        SDL_Log("Failed to map %s: %lu", path, GetLastError());
+        CloseHandle(handle);
+        return false;
+    }
+    mapping.data = static_cast<const uint8_t*>(data);
+    mapping.size = size.QuadPart;
+    mapping.handle = handle;
+    return true;
+}
+
+void UnmapFile(Mapping& mapping)
+{
+    if (mapping.data)
+    {
+        UnmapViewOfFile(mapping.data);
+        CloseHandle(mapping.handle);
+    }
+    mapping = {};
+}
+
+#else
+
+bool MapFile(const char* path, Mapping& mapping)
+{
+    mapping = {};
+    int file = open(path, O_RDONLY);
+    if (file == -1)
+    {
+        SDL_Log("Failed to open %s", path);
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) == -1 || !info.st_size)
+    {
+        SDL_Log("Failed to get the size of %s", path);
+        close(file);
+        return false;
+    }
+    /* the mapping keeps the file open */
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        SDL_Log("Failed to map %s", path);
+        return false;
+    }
+    mapping.data = static_cast<const uint8_t*>(data);
+    mapping.size = info.st_size;
+    return true;
+}
+
+void UnmapFile(Mapping& mapping)
+{
+    if (mapping.data)
+    {
+        munmap(const_cast<uint8_t*>(mapping.data), mapping.size);
+    }
+    mapping = {};
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* a read only view of a whole file, paged in by the os on first touch */
+struct Mapping
+{
+    const uint8_t* data;
+    size_t size;
+    void* handle;
+};
+
+bool MapFile(const char* path, Mapping& mapping);
+void UnmapFile(Mapping& mapping);
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include <SDL3/SDL.h>
+
+#if defined(SDL_PLATFORM_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "network.hpp"
+
+#if defined(SDL_PLATFORM_WIN32)
+typedef int Length;
+#define poll WSAPoll
+#define MSG_NOSIGNAL 0
+#define SHUT_RDWR SD_BOTH
+#else
+typedef ssize_t Length;
+#define closesocket close
+#endif
+
+static bool Startup()
+{
+#if defined(SDL_PLATFORM_WIN32)
+    static bool started;
+    if (!started)
+    {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data))
+        {
+            SDL_Log("Failed to start winsock");
+            return false;
+        }
+        started = true;
+    }
+#endif
+    return true;
+}
+
+Socket ListenTcp(uint16_t port)
+{
+    if (!Startup())
+    {
+        return -1;
+    }
+    Socket listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener == -1)
+    {
+        SDL_Log("Failed to create socket");
+        return -1;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(listener, SOMAXCONN) == -1)
+    {
+        SDL_Log("Failed to listen on port %u", port);
+        closesocket(listener);
+        return -1;
+    }
+    return listener;
+}
+
+Socket ListenUnix(const char* path)
+{
+    if (!Startup())
+    {
+        return -1;
+    }
+    sockaddr_un address{};
+    if (std::strlen(path) >= sizeof(address.sun_path))
+    {
+        SDL_Log("Socket path too long: %s", path);
+        return -1;
+    }
+    Socket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener == -1)
+    {
+        SDL_Log("Failed to create socket");
+        return -1;
+    }
+    /* left behind by a previous run */
+    std::remove(path);
+    address.sun_family = AF_UNIX;
+    std::strcpy(address.sun_path, path);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(listener, SOMAXCONN) == -1)
+    {
+        SDL_Log("Failed to listen on %s", path);
+        closesocket(listener);
+        return -1;
+    }
+    return listener;
+}
+
+Socket ConnectTcp(const char* host, uint16_t port)
+{
+    if (!Startup())
+    {
+        return -1;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses;
+    if (getaddrinfo(host, std::to_string(port).c_str(), &hints, &addresses))
+    {
+        SDL_Log("Failed to resolve %s", host);
+        return -1;
+    }
+    Socket connection = -1;
+    for (addrinfo* address = addresses; address && connection == -1; address = address->ai_next)
+    {
+        connection = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (connection != -1 && connect(connection, address->ai_addr, address->ai_addrlen) == -1)
+        {
+            closesocket(connection);
+            connection = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (connection == -1)
+    {
+        SDL_Log("Failed to connect to %s:%u", host, port);
+        return -1;
+    }
+    /* messages are written whole so don't hold back their tails */
+    int nodelay = 1;
+    setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+    return connection;
+}
+
+Socket AcceptSocket(Socket listener)
+{
+    Socket connection = accept(listener, nullptr, nullptr);
+    if (connection == -1)
+    {
+        SDL_Log("Failed to accept connection");
+    }
+    return connection;
+}
+
+bool WaitSocket(Socket socket, int timeout)
+{
+    pollfd descriptor{};
+    descriptor.fd = socket;
+    descriptor.events = POLLIN;
+    return poll(&descriptor, 1, timeout) > 0;
+}
+
+bool WaitSockets(const Socket* sockets, int count, int timeout)
+{
+    std::vector<pollfd> descriptors(count);
+    for (int i = 0; i < count; i++)
+    {
+        descriptors[i].fd = sockets[i];
+        descriptors[i].events = POLLIN;
+    }
+    return poll(descriptors.data(), count, timeout) > 0;
+}
+
+void SetSocketTimeout(Socket socket, int timeout)
+{
+#if defined(SDL_PLATFORM_WIN32)
+    DWORD value = timeout;
+#else
+    timeval value{};
+    value.tv_sec = timeout / 1000;
+    value.tv_usec = timeout % 1000 * 1000;
+#endif
+    setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool SendSocket(Socket socket, const void* data, size_t size)
+{
+    const char* bytes = static_cast<const char*>(data);
+    while (size)
+    {
+        Length sent = send(socket, bytes, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        bytes += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+bool ReceiveSocket(Socket socket, void* data, size_t size)
+{
+    char* bytes = static_cast<char*>(data);
+    while (size)
+    {
+        Length received = recv(socket, bytes, size, 0);
+        if (received <= 0)
+        {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+    return true;
+}
+
+int ReadSocket(Socket socket, void* data, size_t size)
+{
+    return recv(socket, static_cast<char*>(data), size, 0);
+}
+
+void ShutdownSocket(Socket socket)
+{
+    if (socket != -1)
+    {
+        shutdown(socket, SHUT_RDWR);
+    }
+}
+
+void CloseSocket(Socket socket)
+{
+    if (socket != -1)
+    {
+        closesocket(socket);
+    }
+}
\ No newline at end of file
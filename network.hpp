@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/* blocking tcp and unix domain stream sockets, -1 when invalid */
+typedef intptr_t Socket;
+
+Socket ListenTcp(uint16_t port);
+Socket ListenUnix(const char* path);
+Socket ConnectTcp(const char* host, uint16_t port);
+Socket AcceptSocket(Socket listener);
+/* true when a read (or accept) won't block, waiting up to timeout ms */
+bool WaitSocket(Socket socket, int timeout);
+bool WaitSockets(const Socket* sockets, int count, int timeout);
+/* sends give up after timeout ms so a stalled peer can be dropped */
+void SetSocketTimeout(Socket socket, int timeout);
+bool SendSocket(Socket socket, const void* data, size_t size);
+bool ReceiveSocket(Socket socket, void* data, size_t size);
+/* whatever has arrived, 0 once closed and -1 on failure */
+int ReadSocket(Socket socket, void* data, size_t size);
+/* wakes a thread blocked in a receive before closing */
+void ShutdownSocket(Socket socket);
+void CloseSocket(Socket socket);
\ No newline at end of file
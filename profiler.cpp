@@ -0,0 +1,100 @@
+#ifdef PROFILE
+
+#include <SDL3/SDL.h>
+#include <imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+
+#include "config.hpp"
+#include "profiler.hpp"
+
+static const char* Names[PROFILE_COUNT] =
+{
+    "Events",
+    "ImGui",
+    "Draw",
+    "Swapchain",
+    "Simulate",
+    "Upload",
+    "Readback",
+    "GPU",
+};
+
+/* milliseconds per loop iteration, oldest first starting at sampleIndex */
+static float samples[PROFILE_COUNT][PROFILE_SAMPLES];
+static float generations[PROFILE_SAMPLES];
+static uint64_t current[PROFILE_COUNT];
+static int sampleIndex;
+static int sampleCount;
+
+void AddProfileTime(ProfilePhase phase, uint64_t ns)
+{
+    current[phase] += ns;
+}
+
+void EndProfileFrame(float generationsPerSecond)
+{
+    for (int i = 0; i < PROFILE_COUNT; i++)
+    {
+        samples[i][sampleIndex] = current[i] / 1e6f;
+        current[i] = 0;
+    }
+    generations[sampleIndex] = generationsPerSecond;
+    sampleIndex = (sampleIndex + 1) % PROFILE_SAMPLES;
+    sampleCount = std::min(sampleCount + 1, PROFILE_SAMPLES);
+}
+
+void DrawProfiler()
+{
+    if (!ImGui::CollapsingHeader("Profiler"))
+    {
+        return;
+    }
+    for (int i = 0; i < PROFILE_COUNT; i++)
+    {
+        float total = 0.0f;
+        for (int j = 0; j < sampleCount; j++)
+        {
+            total += samples[i][j];
+        }
+        char overlay[32];
+        std::snprintf(overlay, sizeof(overlay), "%.3f ms", sampleCount ? total / sampleCount : 0.0f);
+        ImGui::PlotHistogram(Names[i], samples[i], PROFILE_SAMPLES, sampleIndex, overlay, 0.0f, FLT_MAX, ImVec2{0.0f, 32.0f});
+    }
+    if (ImGui::Button("Export CSV"))
+    {
+        ExportProfile("profile.csv");
+    }
+}
+
+bool ExportProfile(const char* path)
+{
+    FILE* file = std::fopen(path, "w");
+    if (!file)
+    {
+        SDL_Log("Failed to open csv: %s", path);
+        return false;
+    }
+    for (int i = 0; i < PROFILE_COUNT; i++)
+    {
+        std::fprintf(file, "%s (ms),", Names[i]);
+    }
+    std::fprintf(file, "Generations/s,Cell updates/s\n");
+    for (int i = 0; i < sampleCount; i++)
+    {
+        int j = (sampleIndex - sampleCount + i + PROFILE_SAMPLES) % PROFILE_SAMPLES;
+        for (int k = 0; k < PROFILE_COUNT; k++)
+        {
+            std::fprintf(file, "%f,", samples[k][j]);
+        }
+        std::fprintf(file, "%f,%f\n", generations[j], generations[j] * BOUNDS * BOUNDS * BOUNDS);
+    }
+    std::fclose(file);
+    SDL_Log("Exported %d frames to %s", sampleCount, path);
+    return true;
+}
+
+#endif
\ No newline at end of file
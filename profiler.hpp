@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+
+/* scoped cpu timers and fence timings, compiled out unless PROFILE is set */
+#ifdef PROFILE
+
+#include <SDL3/SDL.h>
+
+enum ProfilePhase
+{
+    PROFILE_EVENTS,
+    PROFILE_IMGUI,
+    PROFILE_DRAW,
+    PROFILE_SWAPCHAIN,
+    PROFILE_SIMULATE,
+    PROFILE_UPLOAD,
+    PROFILE_READBACK,
+    PROFILE_GPU,
+    PROFILE_COUNT,
+};
+
+void AddProfileTime(ProfilePhase phase, uint64_t ns);
+void EndProfileFrame(float generationsPerSecond);
+void DrawProfiler();
+bool ExportProfile(const char* path);
+
+struct ProfileScope
+{
+    ProfilePhase phase;
+    uint64_t start;
+
+    ProfileScope(ProfilePhase phase)
+        : phase{phase}
+        , start{SDL_GetTicksNS()}
+    {
+    }
+
+    ~ProfileScope()
+    {
+        AddProfileTime(phase, SDL_GetTicksNS() - start);
+    }
+};
+
+#define PROFILE_CONCAT2(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT2(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope, __LINE__){phase}
+#define PROFILE_TIME(phase, ns) AddProfileTime(phase, ns)
+#define PROFILE_FRAME(generationsPerSecond) EndProfileFrame(generationsPerSecond)
+#define PROFILE_DRAW() DrawProfiler()
+
+#else
+
+#define PROFILE_SCOPE(phase)
+#define PROFILE_TIME(phase, ns)
+#define PROFILE_FRAME(generationsPerSecond)
+#define PROFILE_DRAW()
+
+#endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include <SDL3/SDL.h>
+
+#if defined(SDL_PLATFORM_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "config.hpp"
+#include "engine.hpp"
+#include "publisher.hpp"
+#include "readback.hpp"
+#include "trace.hpp"
+
+static constexpr char Magic[4] = {'C', 'A', '3', 'P'};
+static constexpr uint32_t Version = 1;
+static constexpr size_t Cells = BOUNDS * BOUNDS * BOUNDS;
+
+static_assert(Cells % 8 == 0);
+
+static std::string name;
+static uint8_t* data;
+static size_t size;
+static void* handle;
+static bool packed;
+/* read when a generation arrives so later changes are picked up */
+static const Rules* source;
+static uint32_t stride;
+static uint64_t published;
+static uint32_t publishedGeneration;
+static bool publishing;
+
+static uint8_t* Create(const char* path)
+{
+#if defined(SDL_PLATFORM_WIN32)
+    /* backed by the page file and gone once every handle is closed */
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+        static_cast<DWORD>(static_cast<uint64_t>(size) >> 32), static_cast<DWORD>(size), path);
+    if (!mapping)
+    {
+        SDL_Log("Failed to create shared memory %s: %lu", path, GetLastError());
+        return nullptr;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!view)
+    {
+        SDL_Log("Failed to map shared memory %s: %lu", path, GetLastError());
+        CloseHandle(mapping);
+        return nullptr;
+    }
+    handle = mapping;
+    return static_cast<uint8_t*>(view);
+#else
+    /* a stale ring from a crashed run may have another size */
+    shm_unlink(path);
+    int file = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (file == -1)
+    {
+        SDL_Log("Failed to create shared memory %s", path);
+        return nullptr;
+    }
+    if (ftruncate(file, size) == -1)
+    {
+        SDL_Log("Failed to size shared memory %s", path);
+        close(file);
+        shm_unlink(path);
+        return nullptr;
+    }
+    void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    close(file);
+    if (view == MAP_FAILED)
+    {
+        SDL_Log("Failed to map shared memory %s", path);
+        shm_unlink(path);
+        return nullptr;
+    }
+    return static_cast<uint8_t*>(view);
+#endif
+}
+
+static void Destroy()
+{
+#if defined(SDL_PLATFORM_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle(handle);
+#else
+    /* readers keep their mappings until they unmap */
+    munmap(data, size);
+    shm_unlink(name.c_str());
+#endif
+    data = nullptr;
+    handle = nullptr;
+}
+
+static void Pack(const uint8_t* cells, uint8_t* bits)
+{
+    for (size_t i = 0; i < Cells; i += 8)
+    {
+        uint8_t byte = 0;
+        for (int j = 0; j < 8; j++)
+        {
+            byte |= (cells[i + j] > 0) << j;
+        }
+        bits[i / 8] = byte;
+    }
+}
+
+static void PublishCallback(uint32_t generation, const uint8_t* cells, void*)
+{
+    /* also requested for saving or the start of a recording */
+    if (published && generation == publishedGeneration)
+    {
+        return;
+    }
+    TRACE_SCOPE("Publish");
+    uint64_t sequence = published + 1;
+    PublishHeader* header = reinterpret_cast<PublishHeader*>(data);
+    PublishSlot* slot = reinterpret_cast<PublishSlot*>(data + sizeof(PublishHeader) + (sequence - 1) % PUBLISH_SLOTS * stride);
+    /* readers still on the old contents see this and discard what they read */
+    slot->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->rules = *source;
+    slot->rules.frame = generation;
+    uint8_t* slotCells = reinterpret_cast<uint8_t*>(slot + 1);
+    if (packed)
+    {
+        Pack(cells, slotCells);
+    }
+    else
+    {
+        std::memcpy(slotCells, cells, Cells);
+    }
+    slot->sequence.store(sequence, std::memory_order_release);
+    header->sequence.store(sequence, std::memory_order_release);
+    published = sequence;
+    publishedGeneration = generation;
+}
+
+bool StartPublishing(const char* path, bool pack, const Rules* rules)
+{
+    StopPublishing();
+    /* posix names need a single leading slash */
+    name = path;
+#if !defined(SDL_PLATFORM_WIN32)
+    if (name.empty() || name[0] != '/')
+    {
+        name.insert(name.begin(), '/');
+    }
+#endif
+    packed = pack;
+    source = rules;
+    stride = (sizeof(PublishSlot) + (packed ? Cells / 8 : Cells) + 63) / 64 * 64;
+    size = sizeof(PublishHeader) + static_cast<size_t>(stride) * PUBLISH_SLOTS;
+    data = Create(name.c_str());
+    if (!data)
+    {
+        return false;
+    }
+    PublishHeader* header = new (data) PublishHeader{};
+    header->version = Version;
+    header->bounds = BOUNDS;
+    header->slots = PUBLISH_SLOTS;
+    header->packed = packed;
+    header->stride = stride;
+    for (int i = 0; i < PUBLISH_SLOTS; i++)
+    {
+        new (data + sizeof(PublishHeader) + i * stride) PublishSlot{};
+    }
+    /* last so a reader attaching early sees an unfinished header as a bad one */
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, Magic, sizeof(Magic));
+    if (!AddReadbackConsumer(PublishCallback, nullptr))
+    {
+        Destroy();
+        return false;
+    }
+    published = 0;
+    publishing = true;
+    SDL_Log("Publishing to %s (%u slots of %u bytes)", name.c_str(), PUBLISH_SLOTS, stride);
+    return true;
+}
+
+void StopPublishing()
+{
+    if (!publishing)
+    {
+        return;
+    }
+    RemoveReadbackConsumer(PublishCallback, nullptr);
+    Destroy();
+    publishing = false;
+    SDL_Log("Published %llu generations", static_cast<unsigned long long>(published));
+}
+
+bool IsPublishing()
+{
+    return publishing;
+}
+
+uint64_t GetPublishedCount()
+{
+    return published;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "engine.hpp"
+
+/* every read back generation is copied into a shared memory ring (posix
+ * shm_open, a named mapping on windows) for other processes to map. sequence
+ * s goes in slot (s - 1) % slots, so a reader takes a sequence, checks the
+ * slot has it, reads the cells in place and checks the slot again, since a
+ * slow reader gets overwritten rather than waited for */
+struct alignas(64) PublishHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t bounds;
+    uint32_t slots;
+    /* one bit per cell (set when alive or decaying, x first from the low
+     * bit) or one byte per cell like the textures */
+    uint32_t packed;
+    /* bytes from one slot to the next, the first starting after the header */
+    uint32_t stride;
+    /* newest complete slot, 0 before the first */
+    std::atomic<uint64_t> sequence;
+};
+
+struct alignas(64) PublishSlot
+{
+    /* 0 while being written */
+    std::atomic<uint64_t> sequence;
+    /* rules.frame is the generation */
+    Rules rules;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+bool StartPublishing(const char* name, bool packed, const Rules* rules);
+void StopPublishing();
+bool IsPublishing();
+uint64_t GetPublishedCount();
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include <SDL3/SDL.h>
+
+#include <cstdint>
+
+#include "config.hpp"
+#include "readback.hpp"
+
+#define CONSUMERS 8
+
+struct Slot
+{
+    SDL_GPUTransferBuffer* buffer;
+    /* null when the download was queued into a batch */
+    SDL_GPUFence* fence;
+    bool signaled;
+    uint32_t generation;
+};
+
+struct Consumer
+{
+    ReadbackCallback callback;
+    void* userdata;
+};
+
+/* in flight downloads, oldest first starting at head, then pending ones */
+static Slot slots[READBACKS];
+static int head;
+static int count;
+static int pending;
+static Consumer consumers[CONSUMERS];
+
+bool CreateReadbacks(SDL_GPUDevice* device)
+{
+    for (int i = 0; i < READBACKS; i++)
+    {
+        SDL_GPUTransferBufferCreateInfo info{};
+        info.usage = SDL_GPU_TRANSFERBUFFERUSAGE_DOWNLOAD;
+        info.size = BOUNDS * BOUNDS * BOUNDS;
+        slots[i].buffer = SDL_CreateGPUTransferBuffer(device, &info);
+        if (!slots[i].buffer)
+        {
+            SDL_Log("Failed to create transfer buffer: %s", SDL_GetError());
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReleaseReadbacks(SDL_GPUDevice* device)
+{
+    for (int i = 0; i < READBACKS; i++)
+    {
+        SDL_ReleaseGPUFence(device, slots[i].fence);
+        SDL_ReleaseGPUTransferBuffer(device, slots[i].buffer);
+        slots[i] = {};
+    }
+    count = 0;
+    pending = 0;
+}
+
+bool AddReadbackConsumer(ReadbackCallback callback, void* userdata)
+{
+    for (Consumer& consumer : consumers)
+    {
+        if (!consumer.callback)
+        {
+            consumer.callback = callback;
+            consumer.userdata = userdata;
+            return true;
+        }
+    }
+    SDL_Log("Too many readback consumers");
+    return false;
+}
+
+void RemoveReadbackConsumer(ReadbackCallback callback, void* userdata)
+{
+    for (Consumer& consumer : consumers)
+    {
+        if (consumer.callback == callback && consumer.userdata == userdata)
+        {
+            consumer = {};
+        }
+    }
+}
+
+bool HasReadbackConsumers()
+{
+    for (const Consumer& consumer : consumers)
+    {
+        if (consumer.callback)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RequestReadback(SDL_GPUDevice* device, SDL_GPUTexture* texture, uint32_t generation)
+{
+    /* drop rather than wait when the consumers fall behind */
+    if (count + pending == READBACKS)
+    {
+        return false;
+    }
+    Slot& slot = slots[(head + count + pending) % READBACKS];
+    SDL_GPUCommandBuffer* commandBuffer = SDL_AcquireGPUCommandBuffer(device);
+    if (!commandBuffer)
+    {
+        SDL_Log("Failed to acquire command buffer: %s", SDL_GetError());
+        return false;
+    }
+    SDL_GPUCopyPass* copyPass = SDL_BeginGPUCopyPass(commandBuffer);
+    if (!copyPass)
+    {
+        SDL_Log("Failed to begin copy pass: %s", SDL_GetError());
+        SDL_CancelGPUCommandBuffer(commandBuffer);
+        return false;
+    }
+    SDL_GPUTextureRegion region{};
+    SDL_GPUTextureTransferInfo info{};
+    region.texture = texture;
+    region.w = BOUNDS;
+    region.h = BOUNDS;
+    region.d = BOUNDS;
+    info.transfer_buffer = slot.buffer;
+    SDL_DownloadFromGPUTexture(copyPass, &region, &info);
+    SDL_EndGPUCopyPass(copyPass);
+    slot.fence = SDL_SubmitGPUCommandBufferAndAcquireFence(commandBuffer);
+    if (!slot.fence)
+    {
+        SDL_Log("Failed to submit command buffer: %s", SDL_GetError());
+        return false;
+    }
+    slot.signaled = false;
+    slot.generation = generation;
+    count++;
+    return true;
+}
+
+int GetFreeReadbacks()
+{
+    return READBACKS - count - pending;
+}
+
+bool QueueReadback(SDL_GPUCopyPass* copyPass, SDL_GPUTexture* texture, uint32_t generation)
+{
+    if (count + pending == READBACKS)
+    {
+        return false;
+    }
+    Slot& slot = slots[(head + count + pending) % READBACKS];
+    SDL_GPUTextureRegion region{};
+    SDL_GPUTextureTransferInfo info{};
+    region.texture = texture;
+    region.w = BOUNDS;
+    region.h = BOUNDS;
+    region.d = BOUNDS;
+    info.transfer_buffer = slot.buffer;
+    SDL_DownloadFromGPUTexture(copyPass, &region, &info);
+    slot.fence = nullptr;
+    slot.signaled = false;
+    slot.generation = generation;
+    pending++;
+    return true;
+}
+
+int SubmitReadbacks()
+{
+    int submitted = pending;
+    count += pending;
+    pending = 0;
+    return submitted;
+}
+
+void CancelReadbacks()
+{
+    pending = 0;
+}
+
+void SignalReadbacks(int signals)
+{
+    for (int i = 0; i < count && signals; i++)
+    {
+        Slot& slot = slots[(head + i) % READBACKS];
+        if (!slot.fence && !slot.signaled)
+        {
+            slot.signaled = true;
+            signals--;
+        }
+    }
+}
+
+void PollReadbacks(SDL_GPUDevice* device, bool wait)
+{
+    while (count)
+    {
+        Slot& slot = slots[head];
+        if (!slot.fence)
+        {
+            /* nothing to wait on, its batch retires first */
+            if (!slot.signaled)
+            {
+                break;
+            }
+        }
+        else if (wait)
+        {
+            SDL_WaitForGPUFences(device, true, &slot.fence, 1);
+        }
+        else if (!SDL_QueryGPUFence(device, slot.fence))
+        {
+            break;
+        }
+        SDL_ReleaseGPUFence(device, slot.fence);
+        slot.fence = nullptr;
+        slot.signaled = false;
+        head = (head + 1) % READBACKS;
+        count--;
+        const uint8_t* data = static_cast<const uint8_t*>(SDL_MapGPUTransferBuffer(device, slot.buffer, false));
+        if (!data)
+        {
+            SDL_Log("Failed to map transfer buffer: %s", SDL_GetError());
+            continue;
+        }
+        DispatchReadback(slot.generation, data);
+        SDL_UnmapGPUTransferBuffer(device, slot.buffer);
+    }
+}
+
+void DispatchReadback(uint32_t generation, const uint8_t* cells)
+{
+    for (const Consumer& consumer : consumers)
+    {
+        if (consumer.callback)
+        {
+            consumer.callback(generation, cells, consumer.userdata);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <cstdint>
+
+/* cells arrive on the main thread, laid out like the texture */
+typedef void (*ReadbackCallback)(uint32_t generation, const uint8_t* cells, void* userdata);
+
+bool CreateReadbacks(SDL_GPUDevice* device);
+void ReleaseReadbacks(SDL_GPUDevice* device);
+bool AddReadbackConsumer(ReadbackCallback callback, void* userdata);
+void RemoveReadbackConsumer(ReadbackCallback callback, void* userdata);
+bool HasReadbackConsumers();
+bool RequestReadback(SDL_GPUDevice* device, SDL_GPUTexture* texture, uint32_t generation);
+/* downloads recorded into a batch, pending until the batch is submitted
+ * and then signaled in order as batches retire */
+int GetFreeReadbacks();
+bool QueueReadback(SDL_GPUCopyPass* copyPass, SDL_GPUTexture* texture, uint32_t generation);
+int SubmitReadbacks();
+void CancelReadbacks();
+void SignalReadbacks(int signals);
+void PollReadbacks(SDL_GPUDevice* device, bool wait);
+void DispatchReadback(uint32_t generation, const uint8_t* cells);
\ No newline at end of file
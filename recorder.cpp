@@ -0,0 +1,406 @@
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+#include "delta.hpp"
+#include "engine.hpp"
+#include "mapping.hpp"
+#include "readback.hpp"
+#include "recorder.hpp"
+#include "trace.hpp"
+
+static constexpr char Magic[4] = {'C', 'A', '3', 'R'};
+static constexpr char RecordMagic[4] = {'C', 'A', '3', 'F'};
+static constexpr char IndexMagic[4] = {'C', 'A', '3', 'I'};
+static constexpr uint32_t Version = 2;
+static constexpr size_t Size = BOUNDS * BOUNDS * BOUNDS;
+
+/* the rules are the ones recording started with */
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t bounds;
+    uint32_t keyframe;
+    Rules rules;
+};
+
+/* before every frame so a recording that was never stopped can be scanned,
+ * with the rules it was stepped with since they can change while recording */
+struct Record
+{
+    char magic[4];
+    uint32_t generation;
+    uint32_t keyframe;
+    uint32_t size;
+    Rules rules;
+};
+
+struct Entry
+{
+    uint32_t generation;
+    uint32_t keyframe;
+    uint64_t offset;
+};
+
+struct Footer
+{
+    uint64_t offset;
+    uint64_t count;
+    char magic[4];
+    uint32_t version;
+};
+
+static std::thread thread;
+static std::mutex mutex;
+static std::condition_variable condition;
+static std::vector<uint8_t> queue[RECORD_QUEUE];
+static Rules queueRules[RECORD_QUEUE];
+static const Rules* source;
+static int queueHead;
+static int queueCount;
+static bool stopping;
+static bool recording;
+static bool recorded;
+static uint32_t recordedGeneration;
+static std::ofstream file;
+static std::vector<Entry> entries;
+static std::atomic<uint32_t> writtenGenerations;
+static std::atomic<uint64_t> writtenBytes;
+
+static Mapping mapping;
+static std::vector<Entry> replayEntries;
+static std::vector<uint8_t> replayCells;
+static int64_t replayIndex{-1};
+
+static void Run()
+{
+    SetTraceThread("Recorder");
+    std::vector<uint8_t> cells(Size);
+    std::vector<uint8_t> previous(Size);
+    std::vector<uint8_t> data;
+    uint32_t last = 0;
+    int sinceKeyframe = 0;
+    uint64_t offset = sizeof(Header);
+    bool failed = false;
+    while (true)
+    {
+        Rules rules;
+        {
+            std::unique_lock lock(mutex);
+            condition.wait(lock, [] { return queueCount || stopping; });
+            if (!queueCount)
+            {
+                break;
+            }
+            /* the slot gets the buffer that was just written out */
+            cells.swap(queue[queueHead]);
+            rules = queueRules[queueHead];
+            queueHead = (queueHead + 1) % RECORD_QUEUE;
+            queueCount--;
+        }
+        condition.notify_all();
+        TRACE_SCOPE("Record");
+        uint32_t generation = rules.frame;
+        /* a reset or a dropped generation can't be bridged by a delta */
+        bool keyframe = entries.empty() || generation != last + 1 || sinceKeyframe == RECORD_KEYFRAME;
+        EncodeDelta(cells.data(), keyframe ? nullptr : previous.data(), data);
+        Record record{};
+        std::memcpy(record.magic, RecordMagic, sizeof(RecordMagic));
+        record.generation = generation;
+        record.keyframe = keyframe;
+        record.size = data.size();
+        record.rules = rules;
+        entries.push_back({generation, keyframe, offset});
+        file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (file.fail() && !failed)
+        {
+            SDL_Log("Failed to write recording");
+            failed = true;
+        }
+        offset += sizeof(record) + data.size();
+        sinceKeyframe = keyframe ? 1 : sinceKeyframe + 1;
+        last = generation;
+        previous.swap(cells);
+        writtenGenerations = entries.size();
+        writtenBytes = offset;
+    }
+}
+
+static void RecordCallback(uint32_t generation, const uint8_t* cells, void*)
+{
+    /* a save while paused reads back the last generation again */
+    if (recorded && generation == recordedGeneration)
+    {
+        return;
+    }
+    {
+        std::lock_guard lock(mutex);
+        if (queueCount == RECORD_QUEUE)
+        {
+            /* the gap makes the next one a keyframe */
+            return;
+        }
+        int slot = (queueHead + queueCount) % RECORD_QUEUE;
+        std::memcpy(queue[slot].data(), cells, Size);
+        queueRules[slot] = *source;
+        queueRules[slot].frame = generation;
+        queueCount++;
+    }
+    condition.notify_all();
+    recorded = true;
+    recordedGeneration = generation;
+}
+
+bool StartRecording(const char* path, const Rules* rules)
+{
+    StopRecording();
+    file.open(path, std::ios::binary);
+    if (file.fail())
+    {
+        SDL_Log("Failed to open recording: %s", path);
+        file.clear();
+        return false;
+    }
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.bounds = BOUNDS;
+    header.keyframe = RECORD_KEYFRAME;
+    header.rules = *rules;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!AddReadbackConsumer(RecordCallback, nullptr))
+    {
+        file.close();
+        return false;
+    }
+    for (std::vector<uint8_t>& cells : queue)
+    {
+        cells.resize(Size);
+    }
+    queueHead = 0;
+    queueCount = 0;
+    stopping = false;
+    recorded = false;
+    entries.clear();
+    source = rules;
+    writtenGenerations = 0;
+    writtenBytes = sizeof(header);
+    thread = std::thread(Run);
+    recording = true;
+    SDL_Log("Recording to %s", path);
+    return true;
+}
+
+void StopRecording()
+{
+    if (!recording)
+    {
+        return;
+    }
+    RemoveReadbackConsumer(RecordCallback, nullptr);
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    /* drains the queue first */
+    thread.join();
+    recording = false;
+    Footer footer{};
+    footer.offset = writtenBytes;
+    footer.count = entries.size();
+    std::memcpy(footer.magic, IndexMagic, sizeof(IndexMagic));
+    footer.version = Version;
+    file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+    file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    file.close();
+    if (file.fail())
+    {
+        SDL_Log("Failed to write recording");
+        file.clear();
+    }
+    SDL_Log("Recorded %zu generations (%llu bytes)", entries.size(),
+        static_cast<unsigned long long>(footer.offset + footer.count * sizeof(Entry) + sizeof(footer)));
+    entries.clear();
+    for (std::vector<uint8_t>& cells : queue)
+    {
+        cells = {};
+    }
+}
+
+bool IsRecording()
+{
+    return recording;
+}
+
+int GetRecordingCapacity()
+{
+    std::lock_guard lock(mutex);
+    return RECORD_QUEUE - queueCount;
+}
+
+void GetRecordingStats(uint32_t& generations, uint64_t& bytes)
+{
+    generations = writtenGenerations;
+    bytes = writtenBytes;
+}
+
+static bool ReadIndex()
+{
+    if (mapping.size < sizeof(Header) + sizeof(Footer))
+    {
+        return false;
+    }
+    Footer footer;
+    std::memcpy(&footer, mapping.data + mapping.size - sizeof(footer), sizeof(footer));
+    if (std::memcmp(footer.magic, IndexMagic, sizeof(IndexMagic)) || footer.version != Version)
+    {
+        return false;
+    }
+    uint64_t end = mapping.size - sizeof(footer);
+    if (footer.offset < sizeof(Header) || footer.offset > end || (end - footer.offset) % sizeof(Entry) ||
+        footer.count != (end - footer.offset) / sizeof(Entry))
+    {
+        return false;
+    }
+    replayEntries.resize(footer.count);
+    std::memcpy(replayEntries.data(), mapping.data + footer.offset, footer.count * sizeof(Entry));
+    for (const Entry& entry : replayEntries)
+    {
+        if (entry.offset < sizeof(Header) || entry.offset + sizeof(Record) > footer.offset)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void ScanIndex()
+{
+    /* everything up to the first frame that was cut off */
+    replayEntries.clear();
+    uint64_t offset = sizeof(Header);
+    while (offset + sizeof(Record) <= mapping.size)
+    {
+        Record record;
+        std::memcpy(&record, mapping.data + offset, sizeof(record));
+        if (std::memcmp(record.magic, RecordMagic, sizeof(RecordMagic)) || record.size > mapping.size - offset - sizeof(record))
+        {
+            break;
+        }
+        replayEntries.push_back({record.generation, record.keyframe, offset});
+        offset += sizeof(record) + record.size;
+    }
+}
+
+bool OpenReplay(const char* path, Rules& rules)
+{
+    CloseReplay();
+    if (!MapFile(path, mapping))
+    {
+        return false;
+    }
+    Header header;
+    if (mapping.size < sizeof(header))
+    {
+        SDL_Log("Invalid recording: %s", path);
+        CloseReplay();
+        return false;
+    }
+    std::memcpy(&header, mapping.data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) || header.version != Version)
+    {
+        SDL_Log("Invalid recording: %s", path);
+        CloseReplay();
+        return false;
+    }
+    if (header.bounds != BOUNDS)
+    {
+        SDL_Log("Recording is %u^3 but the grid is %d^3: %s", header.bounds, BOUNDS, path);
+        CloseReplay();
+        return false;
+    }
+    if (!ReadIndex())
+    {
+        SDL_Log("Recording has no index, scanning: %s", path);
+        ScanIndex();
+    }
+    if (replayEntries.empty() || !replayEntries[0].keyframe)
+    {
+        SDL_Log("Empty recording: %s", path);
+        CloseReplay();
+        return false;
+    }
+    replayCells.assign(Size, 0);
+    replayIndex = -1;
+    rules = header.rules;
+    return true;
+}
+
+void CloseReplay()
+{
+    UnmapFile(mapping);
+    replayEntries.clear();
+    replayCells = {};
+    replayIndex = -1;
+}
+
+uint32_t GetReplayLength()
+{
+    return replayEntries.size();
+}
+
+uint32_t GetReplayGeneration(uint32_t index)
+{
+    return replayEntries[index].generation;
+}
+
+bool ReadReplay(uint32_t index, uint8_t* cells, Rules& rules)
+{
+    if (index >= replayEntries.size())
+    {
+        return false;
+    }
+    int64_t keyframe = index;
+    while (keyframe > 0 && !replayEntries[keyframe].keyframe)
+    {
+        keyframe--;
+    }
+    /* playing forward only applies the next delta */
+    int64_t start = keyframe;
+    if (replayIndex >= keyframe && replayIndex <= index)
+    {
+        start = replayIndex + 1;
+    }
+    for (int64_t i = start; i <= index; i++)
+    {
+        const Entry& entry = replayEntries[i];
+        Record record;
+        std::memcpy(&record, mapping.data + entry.offset, sizeof(record));
+        const uint8_t* data = mapping.data + entry.offset + sizeof(record);
+        if (record.size > mapping.size - entry.offset - sizeof(record) ||
+            !DecodeDelta(data, record.size, replayCells.data(), record.keyframe))
+        {
+            SDL_Log("Corrupt recording at generation %u", entry.generation);
+            replayIndex = -1;
+            return false;
+        }
+        replayIndex = i;
+    }
+    Record record;
+    std::memcpy(&record, mapping.data + replayEntries[index].offset, sizeof(record));
+    std::memcpy(cells, replayCells.data(), Size);
+    rules = record.rules;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "engine.hpp"
+
+/* every read back generation is queued with the current rules for a writer
+ * thread that appends it as a keyframe or a delta of the one before, with an
+ * index at the end, generations that find the queue full are dropped */
+bool StartRecording(const char* path, const Rules* rules);
+void StopRecording();
+bool IsRecording();
+int GetRecordingCapacity();
+void GetRecordingStats(uint32_t& generations, uint64_t& bytes);
+
+/* recordings are mapped and decoded from the nearest keyframe, main thread only */
+bool OpenReplay(const char* path, Rules& rules);
+void CloseReplay();
+uint32_t GetReplayLength();
+uint32_t GetReplayGeneration(uint32_t index);
+bool ReadReplay(uint32_t index, uint8_t* cells, Rules& rules);
\ No newline at end of file
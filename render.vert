@@ -1,24 +1,21 @@
 #version 450
 
+#include "config.hpp"
+
 layout(location = 0) in vec3 inPosition;
-layout(location = 1) in uint inInstance;
 layout(location = 0) out flat uint outValue;
-layout(set = 0, binding = 0, r8ui) uniform readonly uimage3D cells;
-layout(set = 1, binding = 0) uniform uniformViewProjMatrix
-{
-    mat4 viewProjMatrix;
-};
+
+#include "brick.glsl"
 
 void main()
 {
-    ivec3 instance;
-    instance.x = int((inInstance >>  0) & 0x3FF);
-    instance.y = int((inInstance >> 10) & 0x3FF);
-    instance.z = int((inInstance >> 20) & 0x3FF);
-    outValue = imageLoad(cells, instance).x;
+    ivec3 instance = GetBlock();
+    int scale = 1 << lod;
+    outValue = GetValue(instance);
     if (outValue > 0)
     {
-        gl_Position = viewProjMatrix * vec4(inPosition + vec3(instance), 1.0f);
+        vec3 position = vec3(instance * scale) - 0.5f + (inPosition + 0.5f) * float(scale);
+        gl_Position = viewProjMatrix * vec4(position, 1.0f);
     }
     else
     {
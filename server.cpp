@@ -0,0 +1,383 @@
+#include <SDL3/SDL.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define JSMN_HEADER
+#include "jsmn.h"
+
+#include "config.hpp"
+#include "engine.hpp"
+#include "network.hpp"
+#include "server.hpp"
+
+#define TOKENS 256
+#define LINE_SIZE 65536
+
+struct Client
+{
+    Socket socket;
+    std::string buffer;
+};
+
+struct Line
+{
+    Socket socket;
+    std::string text;
+};
+
+static Socket listener{-1};
+static std::string socketPath;
+static std::vector<Client> clients;
+/* complete lines waiting to be run, in the order they arrived */
+static std::deque<Line> lines;
+static Socket jobSocket{-1};
+static uint32_t nextId;
+
+static std::string Quote(std::string_view text)
+{
+    std::string quoted = "\"";
+    for (char character : text)
+    {
+        if (character == '"' || character == '\\')
+        {
+            quoted += '\\';
+        }
+        if (static_cast<unsigned char>(character) >= ' ')
+        {
+            quoted += character;
+        }
+    }
+    return quoted + "\"";
+}
+
+static bool Send(const std::string& text)
+{
+    if (jobSocket == -1)
+    {
+        return false;
+    }
+    std::string line = text + "\n";
+    if (SendSocket(jobSocket, line.data(), line.size()))
+    {
+        return true;
+    }
+    /* read again and dropped with the client */
+    jobSocket = -1;
+    return false;
+}
+
+/* the token after a value and everything nested in it */
+static int Skip(const jsmntok_t* tokens, int index)
+{
+    int children = tokens[index].size;
+    index++;
+    for (int i = 0; i < children; i++)
+    {
+        index = Skip(tokens, index);
+    }
+    return index;
+}
+
+static std::string_view GetText(const std::string& text, const jsmntok_t& token)
+{
+    return std::string_view(text).substr(token.start, token.end - token.start);
+}
+
+static bool GetNumber(const std::string& text, const jsmntok_t& token, uint32_t& value)
+{
+    if (token.type != JSMN_PRIMITIVE)
+    {
+        return false;
+    }
+    char* end;
+    value = std::strtoul(text.c_str() + token.start, &end, 10);
+    return end == text.c_str() + token.end;
+}
+
+/* either a mask or a list of neighbor counts */
+static bool GetMask(const std::string& text, const jsmntok_t* tokens, int index, uint32_t& mask)
+{
+    if (tokens[index].type != JSMN_ARRAY)
+    {
+        return GetNumber(text, tokens[index], mask);
+    }
+    mask = 0;
+    for (int i = 0; i < tokens[index].size; i++)
+    {
+        uint32_t count;
+        if (!GetNumber(text, tokens[index + 1 + i], count) || count > 26)
+        {
+            return false;
+        }
+        mask |= 1u << count;
+    }
+    return true;
+}
+
+static bool Parse(const std::string& text, Job& job, std::string& error)
+{
+    job = {};
+    job.id = ++nextId;
+    jsmn_parser parser;
+    jsmntok_t tokens[TOKENS];
+    jsmn_init(&parser);
+    int count = jsmn_parse(&parser, text.data(), text.size(), tokens, TOKENS);
+    if (count <= 0 || tokens[0].type != JSMN_OBJECT)
+    {
+        error = "Expected a json object";
+        return false;
+    }
+    uint32_t bounds = BOUNDS;
+    for (int i = 1; i < count; i = Skip(tokens, i + 1))
+    {
+        std::string_view key = GetText(text, tokens[i]);
+        const jsmntok_t& value = tokens[i + 1];
+        bool valid = true;
+        if (key == "id")
+        {
+            valid = GetNumber(text, value, job.id);
+        }
+        else if (key == "seed")
+        {
+            valid = GetNumber(text, value, job.rules.seed);
+        }
+        else if (key == "survive")
+        {
+            valid = GetMask(text, tokens, i + 1, job.rules.surviveMask);
+        }
+        else if (key == "birth")
+        {
+            valid = GetMask(text, tokens, i + 1, job.rules.birthMask);
+        }
+        else if (key == "life")
+        {
+            valid = GetNumber(text, value, job.rules.life) && job.rules.life >= 1 && job.rules.life <= 255;
+        }
+        else if (key == "neighborhood")
+        {
+            std::string_view name = GetText(text, value);
+            job.rules.neighborhood = name == "von_neumann" ? VON_NEUMANN : MOORE;
+            valid = value.type == JSMN_STRING && (name == "moore" || name == "von_neumann");
+        }
+        else if (key == "bounds")
+        {
+            valid = GetNumber(text, value, bounds);
+        }
+        else if (key == "generations")
+        {
+            valid = GetNumber(text, value, job.generations);
+        }
+        else if (key == "every")
+        {
+            valid = GetNumber(text, value, job.every);
+        }
+        else if (key == "engine")
+        {
+            std::string_view name = GetText(text, value);
+            job.cpu = name == "cpu";
+            valid = value.type == JSMN_STRING && (name == "cpu" || name == "gpu");
+        }
+        else if (key == "metrics")
+        {
+            valid = value.type == JSMN_ARRAY;
+            for (int j = 0; valid && j < value.size; j++)
+            {
+                std::string_view name = GetText(text, tokens[i + 2 + j]);
+                job.live |= name == "live";
+                job.changed |= name == "changed";
+                valid = tokens[i + 2 + j].type == JSMN_STRING && (name == "live" || name == "changed");
+            }
+        }
+        else if (key == "snapshot")
+        {
+            std::string_view path = GetText(text, value);
+            valid = value.type == JSMN_STRING && path.size() < sizeof(job.snapshot);
+            if (valid)
+            {
+                path.copy(job.snapshot, path.size());
+            }
+        }
+        else
+        {
+            error = std::format("Unknown key {}", key);
+            return false;
+        }
+        if (!valid)
+        {
+            error = std::format("Bad value for {}", key);
+            return false;
+        }
+    }
+    /* the textures and shaders are built for one size */
+    if (bounds != BOUNDS)
+    {
+        error = std::format("Built for bounds of {}", BOUNDS);
+        return false;
+    }
+    if (!job.generations)
+    {
+        error = "Expected generations";
+        return false;
+    }
+    return true;
+}
+
+static void Receive()
+{
+    std::vector<Socket> sockets{listener};
+    for (const Client& client : clients)
+    {
+        sockets.push_back(client.socket);
+    }
+    /* wakes up now and then to check for quitting */
+    if (!WaitSockets(sockets.data(), sockets.size(), 100))
+    {
+        return;
+    }
+    if (WaitSocket(listener, 0))
+    {
+        Socket socket = AcceptSocket(listener);
+        if (socket != -1)
+        {
+            SetSocketTimeout(socket, STREAM_TIMEOUT);
+            clients.push_back({socket, {}});
+        }
+    }
+    for (size_t i = 0; i < clients.size();)
+    {
+        Client& client = clients[i];
+        bool closed = false;
+        if (WaitSocket(client.socket, 0))
+        {
+            char buffer[4096];
+            int size = ReadSocket(client.socket, buffer, sizeof(buffer));
+            if (size > 0)
+            {
+                client.buffer.append(buffer, size);
+            }
+            closed = size <= 0;
+        }
+        size_t end;
+        while ((end = client.buffer.find('\n')) != std::string::npos)
+        {
+            lines.push_back({client.socket, client.buffer.substr(0, end)});
+            client.buffer.erase(0, end + 1);
+        }
+        if (closed || client.buffer.size() > LINE_SIZE)
+        {
+            /* jobs it already sent are dropped when they come up, like the
+             * running one is cancelled once a report to it fails */
+            for (Line& line : lines)
+            {
+                line.socket = line.socket == client.socket ? -1 : line.socket;
+            }
+            CloseSocket(client.socket);
+            clients.erase(clients.begin() + i);
+            continue;
+        }
+        i++;
+    }
+}
+
+bool StartServer(const char* path)
+{
+    listener = ListenUnix(path);
+    if (listener == -1)
+    {
+        return false;
+    }
+    socketPath = path;
+    nextId = 0;
+    SDL_Log("Waiting for jobs on %s", path);
+    return true;
+}
+
+void StopServer()
+{
+    for (const Client& client : clients)
+    {
+        CloseSocket(client.socket);
+    }
+    clients.clear();
+    lines.clear();
+    CloseSocket(listener);
+    listener = -1;
+    std::remove(socketPath.c_str());
+}
+
+bool WaitForJob(Job& job)
+{
+    while (true)
+    {
+        while (!lines.empty())
+        {
+            Line line = lines.front();
+            lines.pop_front();
+            jobSocket = line.socket;
+            std::string error;
+            if (line.socket == -1 || line.text.find_first_not_of(" \t\r") == std::string::npos)
+            {
+                continue;
+            }
+            if (Parse(line.text, job, error))
+            {
+                return true;
+            }
+            FailJob(job, error.c_str());
+        }
+        SDL_Event event;
+        while (SDL_PollEvent(&event))
+        {
+            if (event.type == SDL_EVENT_QUIT)
+            {
+                return false;
+            }
+        }
+        Receive();
+    }
+}
+
+bool ReportJob(const Job& job, uint32_t generation, uint32_t live, bool changed)
+{
+    std::string text = std::format("{{\"id\":{},\"generation\":{}", job.id, generation);
+    if (job.live)
+    {
+        text += std::format(",\"live\":{}", live);
+    }
+    if (job.changed)
+    {
+        text += std::format(",\"changed\":{}", changed);
+    }
+    return Send(text + "}");
+}
+
+void FinishJob(const Job& job, uint32_t generation, uint32_t live, bool changed, float seconds)
+{
+    std::string text = std::format("{{\"id\":{},\"status\":\"done\",\"generation\":{}", job.id, generation);
+    if (job.live)
+    {
+        text += std::format(",\"live\":{}", live);
+    }
+    if (job.changed)
+    {
+        text += std::format(",\"changed\":{}", changed);
+    }
+    if (job.snapshot[0])
+    {
+        text += std::format(",\"snapshot\":{}", Quote(job.snapshot));
+    }
+    Send(text + std::format(",\"seconds\":{:.3f}}}", seconds));
+}
+
+void FailJob(const Job& job, const char* error)
+{
+    Send(std::format("{{\"id\":{},\"status\":\"error\",\"error\":{}}}", job.id, Quote(error)));
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#include "engine.hpp"
+
+/* one run asked for over the control socket */
+struct Job
+{
+    uint32_t id;
+    Rules rules;
+    bool cpu;
+    uint32_t generations;
+    /* generations between reports, 0 for only the last */
+    uint32_t every;
+    bool live;
+    bool changed;
+    /* saved after the last generation unless empty */
+    char snapshot[256];
+};
+
+/* jobs arrive as lines of json on a unix domain socket and are answered
+ * with lines of json on the connection they came from */
+bool StartServer(const char* path);
+void StopServer();
+/* false once quitting, bad jobs being answered here */
+bool WaitForJob(Job& job);
+/* false once whoever sent the job is gone */
+bool ReportJob(const Job& job, uint32_t generation, uint32_t live, bool changed);
+void FinishJob(const Job& job, uint32_t generation, uint32_t live, bool changed, float seconds);
+void FailJob(const Job& job, const char* error);
\ No newline at end of file
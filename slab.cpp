@@ -0,0 +1,317 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+#include "engine.hpp"
+#include "slab.hpp"
+#include "trace.hpp"
+
+static constexpr char Magic[4] = {'C', 'A', '3', 'O'};
+static constexpr uint32_t Version = 1;
+
+/* the rules are the ones the next step uses */
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t size;
+    uint32_t reserved;
+    Rules rules;
+};
+
+/* slices handed between the compute thread and the reader or writer thread */
+struct Queue
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::vector<uint8_t>> slices;
+    /* emptied buffers going back the other way */
+    std::deque<std::vector<uint8_t>> free;
+    bool failed;
+};
+
+static void Push(Queue& queue, std::deque<std::vector<uint8_t>> Queue::* list, std::vector<uint8_t>& slice)
+{
+    {
+        std::lock_guard lock(queue.mutex);
+        (queue.*list).push_back(std::move(slice));
+    }
+    queue.condition.notify_all();
+}
+
+static bool Pop(Queue& queue, std::deque<std::vector<uint8_t>> Queue::* list, std::vector<uint8_t>& slice)
+{
+    std::unique_lock lock(queue.mutex);
+    queue.condition.wait(lock, [&] { return !(queue.*list).empty() || queue.failed; });
+    if ((queue.*list).empty())
+    {
+        return false;
+    }
+    slice = std::move((queue.*list).front());
+    (queue.*list).pop_front();
+    return true;
+}
+
+static void Fail(Queue& queue)
+{
+    {
+        std::lock_guard lock(queue.mutex);
+        queue.failed = true;
+    }
+    queue.condition.notify_all();
+}
+
+/* rows split between threads since a slice of a big grid is megabytes */
+template <typename Function>
+static void ForEachRows(int size, Function function)
+{
+    int threads = std::clamp<int>(std::thread::hardware_concurrency(), 1, size);
+    std::vector<std::thread> workers;
+    for (int i = 1; i < threads; i++)
+    {
+        workers.emplace_back(function, size * i / threads, size * (i + 1) / threads);
+    }
+    function(0, size / threads);
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+/* below or above is null past the ends of the grid */
+static void StepSlice(const Rules& rules, const uint8_t* below, const uint8_t* middle, const uint8_t* above, uint8_t* out, int size)
+{
+    const uint8_t* slices[3] = {below, middle, above};
+    ForEachRows(size, [&](int y0, int y1)
+    {
+        /* live cells in each column of the 3x3 rows around a row */
+        std::vector<uint32_t> columns(size);
+        for (int y = y0; y < y1; y++)
+        {
+            if (rules.neighborhood == VON_NEUMANN)
+            {
+                for (int x = 0; x < size; x++)
+                {
+                    size_t index = static_cast<size_t>(y) * size + x;
+                    uint32_t neighbors = (below && below[index]) + (above && above[index]);
+                    neighbors += (x > 0 && middle[index - 1]) + (x + 1 < size && middle[index + 1]);
+                    neighbors += (y > 0 && middle[index - size]) + (y + 1 < size && middle[index + size]);
+                    out[index] = GetNextCell(rules, middle[index], neighbors);
+                }
+                continue;
+            }
+            std::fill(columns.begin(), columns.end(), 0);
+            for (const uint8_t* slice : slices)
+            {
+                for (int row = std::max(0, y - 1); slice && row <= std::min(size - 1, y + 1); row++)
+                {
+                    const uint8_t* cells = slice + static_cast<size_t>(row) * size;
+                    for (int x = 0; x < size; x++)
+                    {
+                        columns[x] += cells[x] > 0;
+                    }
+                }
+            }
+            for (int x = 0; x < size; x++)
+            {
+                size_t index = static_cast<size_t>(y) * size + x;
+                uint32_t neighbors = columns[x] - (middle[index] > 0);
+                neighbors += x > 0 ? columns[x - 1] : 0;
+                neighbors += x + 1 < size ? columns[x + 1] : 0;
+                out[index] = GetNextCell(rules, middle[index], neighbors);
+            }
+        }
+    });
+}
+
+bool CreateSlabGrid(const char* path, uint32_t size, const Rules& rules)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (file.fail())
+    {
+        SDL_Log("Failed to open grid: %s", path);
+        return false;
+    }
+    /* the seed and the copy after it, like an imported grid */
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.size = size;
+    header.rules = rules;
+    header.rules.frame = 2;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::vector<uint8_t> slice(static_cast<size_t>(size) * size);
+    for (uint32_t z = 0; z < size && !file.fail(); z++)
+    {
+        ForEachRows(size, [&](int y0, int y1)
+        {
+            for (int y = y0; y < y1; y++)
+            for (uint32_t x = 0; x < size; x++)
+            {
+                slice[static_cast<size_t>(y) * size + x] = GetSeedCell(rules.seed, x, y, z);
+            }
+        });
+        file.write(reinterpret_cast<const char*>(slice.data()), slice.size());
+    }
+    if (file.fail())
+    {
+        SDL_Log("Failed to write grid: %s", path);
+        return false;
+    }
+    SDL_Log("Created a %u^3 grid in %s", size, path);
+    return true;
+}
+
+bool StepSlabGrid(const char* input, const char* output, int steps)
+{
+    std::ifstream inFile(input, std::ios::binary);
+    Header header;
+    if (inFile.fail() || !inFile.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, Magic, sizeof(Magic)) || header.version != Version || header.size < 2 ||
+        header.rules.frame < 2)
+    {
+        SDL_Log("Failed to read grid: %s", input);
+        return false;
+    }
+    std::ofstream outFile(output, std::ios::binary);
+    if (outFile.fail())
+    {
+        SDL_Log("Failed to open grid: %s", output);
+        return false;
+    }
+    uint64_t time = SDL_GetTicksNS();
+    int size = header.size;
+    size_t sliceSize = static_cast<size_t>(size) * size;
+    Rules rules = header.rules;
+    header.rules.frame += steps;
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    /* reads and writes overlap the stepping, a few slices ahead and behind */
+    Queue reads{};
+    Queue writes{};
+    for (int i = 0; i < SLAB_QUEUE; i++)
+    {
+        reads.free.emplace_back(sliceSize);
+        writes.free.emplace_back(sliceSize);
+    }
+    std::thread reader([&]
+    {
+        SetTraceThread("Slab reader");
+        for (int z = 0; z < size; z++)
+        {
+            std::vector<uint8_t> slice;
+            if (!Pop(reads, &Queue::free, slice))
+            {
+                return;
+            }
+            TRACE_SCOPE("Read");
+            if (!inFile.read(reinterpret_cast<char*>(slice.data()), sliceSize))
+            {
+                SDL_Log("Failed to read grid: %s", input);
+                Fail(reads);
+                return;
+            }
+            Push(reads, &Queue::slices, slice);
+        }
+    });
+    std::thread writer([&]
+    {
+        SetTraceThread("Slab writer");
+        for (int z = 0; z < size; z++)
+        {
+            std::vector<uint8_t> slice;
+            if (!Pop(writes, &Queue::slices, slice))
+            {
+                return;
+            }
+            TRACE_SCOPE("Write");
+            if (!outFile.write(reinterpret_cast<const char*>(slice.data()), sliceSize))
+            {
+                SDL_Log("Failed to write grid: %s", output);
+                Fail(writes);
+                return;
+            }
+            Push(writes, &Queue::free, slice);
+        }
+    });
+    /* a window of the last three slices in for each step, a step's slice
+     * going to the next step as soon as the slices around it are in */
+    std::vector<std::vector<uint8_t>> windows(steps * 3, std::vector<uint8_t>(sliceSize));
+    std::vector<int> received(steps);
+    std::vector<int> sent(steps);
+    std::vector<uint8_t> out(sliceSize);
+    auto Advance = [&](auto& self, int step) -> bool
+    {
+        /* the last slice has nothing above it */
+        while (sent[step] + 1 < received[step] || (sent[step] < size && received[step] == size))
+        {
+            int slice = sent[step]++;
+            std::vector<uint8_t>* window = &windows[step * 3];
+            const uint8_t* below = slice > 0 ? window[(slice - 1) % 3].data() : nullptr;
+            const uint8_t* above = slice + 1 < size ? window[(slice + 1) % 3].data() : nullptr;
+            Rules stepped = rules;
+            stepped.frame += step;
+            {
+                TRACE_SCOPE("Step");
+                StepSlice(stepped, below, window[slice % 3].data(), above, out.data(), size);
+            }
+            if (step + 1 < steps)
+            {
+                /* before this step sends another, which would overwrite a slice the next step still needs */
+                windows[(step + 1) * 3 + slice % 3].swap(out);
+                received[step + 1]++;
+                if (!self(self, step + 1))
+                {
+                    return false;
+                }
+                continue;
+            }
+            std::vector<uint8_t> written;
+            if (!Pop(writes, &Queue::free, written))
+            {
+                return false;
+            }
+            written.swap(out);
+            Push(writes, &Queue::slices, written);
+        }
+        return true;
+    };
+    bool failed = false;
+    for (int z = 0; z < size && !failed; z++)
+    {
+        std::vector<uint8_t> slice;
+        if (!Pop(reads, &Queue::slices, slice))
+        {
+            failed = true;
+            break;
+        }
+        windows[z % 3].swap(slice);
+        Push(reads, &Queue::free, slice);
+        received[0]++;
+        failed = !Advance(Advance, 0);
+    }
+    if (failed)
+    {
+        Fail(reads);
+        Fail(writes);
+    }
+    reader.join();
+    writer.join();
+    outFile.close();
+    if (failed || outFile.fail())
+    {
+        return false;
+    }
+    float seconds = (SDL_GetTicksNS() - time) / 1e9f;
+    SDL_Log("Stepped %s to generation %u in %.2f s (%.1f million cells/s)", output, header.rules.frame, seconds,
+        static_cast<float>(steps) * size * sliceSize / 1e6f / seconds);
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+#include "engine.hpp"
+
+/* grids too big for memory, kept as a header and then raw z slices in a file
+ * and stepped by streaming the slices through a window of three per
+ * generation, several generations a pass */
+bool CreateSlabGrid(const char* path, uint32_t size, const Rules& rules);
+bool StepSlabGrid(const char* input, const char* output, int steps);
\ No newline at end of file
@@ -0,0 +1,294 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "config.hpp"
+#include "delta.hpp"
+#include "engine.hpp"
+#include "mapping.hpp"
+#include "snapshot.hpp"
+
+static constexpr char Magic[4] = {'C', 'A', '3', 'D'};
+static constexpr uint32_t Version = 2;
+
+enum
+{
+    ENCODING_BITS,
+    ENCODING_NIBBLES,
+    ENCODING_BYTES,
+};
+
+/* followed by a brick for every brick position in z, y, x order */
+struct Header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t bounds;
+    uint32_t brick;
+    Rules rules;
+};
+
+/* empty bricks have no data */
+struct Brick
+{
+    uint64_t offset;
+    uint32_t size;
+    uint32_t encoding;
+};
+
+static int GetBits(uint32_t encoding)
+{
+    switch (encoding)
+    {
+    case ENCODING_BITS:
+        return 1;
+    case ENCODING_NIBBLES:
+        return 4;
+    }
+    return 8;
+}
+
+static uint32_t GetEncoding(uint8_t value)
+{
+    /* from the cells rather than life since life can be lowered mid run */
+    if (value <= 1)
+    {
+        return ENCODING_BITS;
+    }
+    if (value < 16)
+    {
+        return ENCODING_NIBBLES;
+    }
+    return ENCODING_BYTES;
+}
+
+static void Pack(const std::vector<uint8_t>& cells, uint32_t encoding, std::vector<uint8_t>& packed)
+{
+    int bits = GetBits(encoding);
+    packed.assign((cells.size() * bits + 7) / 8, 0);
+    for (size_t i = 0; i < cells.size(); i++)
+    {
+        size_t bit = i * bits;
+        packed[bit / 8] |= cells[i] << (bit % 8);
+    }
+}
+
+static void Unpack(const std::vector<uint8_t>& packed, uint32_t encoding, std::vector<uint8_t>& cells)
+{
+    int bits = GetBits(encoding);
+    uint8_t mask = (1 << bits) - 1;
+    for (size_t i = 0; i < cells.size(); i++)
+    {
+        size_t bit = i * bits;
+        cells[i] = (packed[bit / 8] >> (bit % 8)) & mask;
+    }
+}
+
+static int GetBrickCount(const Snapshot& snapshot)
+{
+    return (snapshot.bounds + snapshot.brick - 1) / snapshot.brick;
+}
+
+bool SaveSnapshot(const char* path, const Rules& rules, const uint8_t* cells)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (file.fail())
+    {
+        SDL_Log("Failed to open snapshot: %s", path);
+        return false;
+    }
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.bounds = BOUNDS;
+    header.brick = SNAPSHOT_BRICK;
+    header.rules = rules;
+    int count = (BOUNDS + SNAPSHOT_BRICK - 1) / SNAPSHOT_BRICK;
+    std::vector<Brick> bricks(count * count * count);
+    /* the directory is written again once the bricks are */
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(bricks.data()), bricks.size() * sizeof(Brick));
+    uint64_t offset = sizeof(header) + bricks.size() * sizeof(Brick);
+    std::vector<uint8_t> brickCells;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> data;
+    for (int bz = 0; bz < count; bz++)
+    for (int by = 0; by < count; by++)
+    for (int bx = 0; bx < count; bx++)
+    {
+        int x1 = bx * SNAPSHOT_BRICK;
+        int y1 = by * SNAPSHOT_BRICK;
+        int z1 = bz * SNAPSHOT_BRICK;
+        int x2 = std::min(x1 + SNAPSHOT_BRICK, BOUNDS);
+        int y2 = std::min(y1 + SNAPSHOT_BRICK, BOUNDS);
+        int z2 = std::min(z1 + SNAPSHOT_BRICK, BOUNDS);
+        brickCells.clear();
+        for (int z = z1; z < z2; z++)
+        for (int y = y1; y < y2; y++)
+        {
+            const uint8_t* row = cells + (z * BOUNDS + y) * BOUNDS;
+            brickCells.insert(brickCells.end(), row + x1, row + x2);
+        }
+        uint8_t value = *std::max_element(brickCells.begin(), brickCells.end());
+        if (!value)
+        {
+            continue;
+        }
+        Brick& brick = bricks[(bz * count + by) * count + bx];
+        brick.encoding = GetEncoding(value);
+        Pack(brickCells, brick.encoding, packed);
+        EncodeRuns(packed.data(), packed.size(), data);
+        brick.offset = offset;
+        brick.size = data.size();
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        offset += data.size();
+    }
+    file.seekp(sizeof(header));
+    file.write(reinterpret_cast<const char*>(bricks.data()), bricks.size() * sizeof(Brick));
+    if (file.fail())
+    {
+        SDL_Log("Failed to write snapshot: %s", path);
+        return false;
+    }
+    SDL_Log("Saved generation %u to %s (%llu bytes)", rules.frame, path, static_cast<unsigned long long>(offset));
+    return true;
+}
+
+bool LoadSnapshot(const char* path, Rules& rules, uint8_t* cells)
+{
+    Snapshot snapshot;
+    if (!OpenSnapshot(path, snapshot))
+    {
+        return false;
+    }
+    if (snapshot.bounds != BOUNDS)
+    {
+        SDL_Log("Snapshot is %u^3 but the grid is %d^3: %s", snapshot.bounds, BOUNDS, path);
+        CloseSnapshot(snapshot);
+        return false;
+    }
+    bool loaded = ReadSnapshotRegion(snapshot, 0, 0, 0, BOUNDS, BOUNDS, BOUNDS, cells);
+    if (!loaded)
+    {
+        SDL_Log("Corrupt snapshot: %s", path);
+    }
+    rules = snapshot.rules;
+    CloseSnapshot(snapshot);
+    return loaded;
+}
+
+bool OpenSnapshot(const char* path, Snapshot& snapshot)
+{
+    snapshot = {};
+    if (!MapFile(path, snapshot.mapping))
+    {
+        return false;
+    }
+    const Mapping& mapping = snapshot.mapping;
+    char magic[4];
+    if (mapping.size < sizeof(magic) + sizeof(uint32_t))
+    {
+        SDL_Log("Invalid snapshot: %s", path);
+        CloseSnapshot(snapshot);
+        return false;
+    }
+    std::memcpy(magic, mapping.data, sizeof(magic));
+    std::memcpy(&snapshot.version, mapping.data + sizeof(magic), sizeof(uint32_t));
+    bool valid = !std::memcmp(magic, Magic, sizeof(Magic));
+    if (valid && snapshot.version == Version && mapping.size >= sizeof(Header))
+    {
+        Header header;
+        std::memcpy(&header, mapping.data, sizeof(header));
+        snapshot.bounds = header.bounds;
+        snapshot.brick = header.brick;
+        snapshot.rules = header.rules;
+        valid = header.brick && header.brick <= header.bounds;
+        if (valid)
+        {
+            uint64_t count = GetBrickCount(snapshot);
+            valid = count <= 1 << 20 && count * count * count <= (mapping.size - sizeof(header)) / sizeof(Brick);
+        }
+    }
+    else
+    {
+        valid = false;
+    }
+    if (!valid || !snapshot.bounds)
+    {
+        SDL_Log("Invalid snapshot: %s", path);
+        CloseSnapshot(snapshot);
+        return false;
+    }
+    return true;
+}
+
+void CloseSnapshot(Snapshot& snapshot)
+{
+    UnmapFile(snapshot.mapping);
+    snapshot = {};
+}
+
+bool ReadSnapshotRegion(const Snapshot& snapshot, int x, int y, int z, int w, int h, int d, uint8_t* cells)
+{
+    int bounds = snapshot.bounds;
+    if (x < 0 || y < 0 || z < 0 || w <= 0 || h <= 0 || d <= 0 || x + w > bounds || y + h > bounds || z + d > bounds)
+    {
+        SDL_Log("Region is outside the snapshot");
+        return false;
+    }
+    std::memset(cells, 0, static_cast<size_t>(w) * h * d);
+    const Mapping& mapping = snapshot.mapping;
+    int brick = snapshot.brick;
+    int count = GetBrickCount(snapshot);
+    std::vector<uint8_t> brickCells;
+    std::vector<uint8_t> packed;
+    for (int bz = z / brick; bz <= (z + d - 1) / brick; bz++)
+    for (int by = y / brick; by <= (y + h - 1) / brick; by++)
+    for (int bx = x / brick; bx <= (x + w - 1) / brick; bx++)
+    {
+        int x1 = bx * brick;
+        int y1 = by * brick;
+        int z1 = bz * brick;
+        int bw = std::min(x1 + brick, bounds) - x1;
+        int bh = std::min(y1 + brick, bounds) - y1;
+        int bd = std::min(z1 + brick, bounds) - z1;
+        Brick entry;
+        size_t index = (static_cast<size_t>(bz) * count + by) * count + bx;
+        std::memcpy(&entry, mapping.data + sizeof(Header) + index * sizeof(Brick), sizeof(entry));
+        if (!entry.size)
+        {
+            continue;
+        }
+        if (entry.offset > mapping.size || entry.size > mapping.size - entry.offset || entry.encoding > ENCODING_BYTES)
+        {
+            return false;
+        }
+        brickCells.resize(static_cast<size_t>(bw) * bh * bd);
+        packed.resize((brickCells.size() * GetBits(entry.encoding) + 7) / 8);
+        if (!DecodeRuns(mapping.data + entry.offset, entry.size, packed.data(), packed.size()))
+        {
+            return false;
+        }
+        Unpack(packed, entry.encoding, brickCells);
+        /* copy the rows where the brick and the box overlap */
+        int cx1 = std::max(x, x1);
+        int cy1 = std::max(y, y1);
+        int cz1 = std::max(z, z1);
+        int cx2 = std::min(x + w, x1 + bw);
+        int cy2 = std::min(y + h, y1 + bh);
+        int cz2 = std::min(z + d, z1 + bd);
+        for (int cz = cz1; cz < cz2; cz++)
+        for (int cy = cy1; cy < cy2; cy++)
+        {
+            const uint8_t* source = brickCells.data() + ((static_cast<size_t>(cz - z1) * bh + cy - y1) * bw + cx1 - x1);
+            uint8_t* destination = cells + ((static_cast<size_t>(cz - z) * h + cy - y) * w + cx1 - x);
+            std::memcpy(destination, source, cx2 - cx1);
+        }
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+#include "engine.hpp"
+#include "mapping.hpp"
+
+/* a header with the rules and a directory of bricks, followed by the bricks
+ * that aren't empty, each packed to 1, 4 or 8 bits depending on its largest
+ * value and then run-length encoded */
+bool SaveSnapshot(const char* path, const Rules& rules, const uint8_t* cells);
+bool LoadSnapshot(const char* path, Rules& rules, uint8_t* cells);
+
+/* a mapped snapshot of any size where reading a box only decodes the
+ * bricks it touches */
+struct Snapshot
+{
+    Mapping mapping;
+    uint32_t version;
+    uint32_t bounds;
+    uint32_t brick;
+    Rules rules;
+};
+
+bool OpenSnapshot(const char* path, Snapshot& snapshot);
+void CloseSnapshot(Snapshot& snapshot);
+bool ReadSnapshotRegion(const Snapshot& snapshot, int x, int y, int z, int w, int h, int d, uint8_t* cells);
\ No newline at end of file
@@ -0,0 +1,27 @@
+#version 450
+
+#include "config.hpp"
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 0) out flat uint outValue;
+
+#include "brick.glsl"
+
+void main()
+{
+    ivec3 instance = GetBlock();
+    int scale = 1 << lod;
+    outValue = GetValue(instance);
+    if (outValue > 0)
+    {
+        /* offsetting in clip space keeps the quad facing the camera and the
+         * divide by w shrinks it with depth */
+        vec3 center = vec3(instance * scale) + 0.5f * float(scale - 1);
+        gl_Position = viewProjMatrix * vec4(center, 1.0f);
+        gl_Position.xy += inPosition.xy * float(scale) * splatScale;
+    }
+    else
+    {
+        gl_Position = vec4(0.0f, 0.0f, 2.0f, 1.0f);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,429 @@
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "config.hpp"
+#include "delta.hpp"
+#include "engine.hpp"
+#include "network.hpp"
+#include "readback.hpp"
+#include "stream.hpp"
+#include "trace.hpp"
+
+static constexpr char Magic[4] = {'C', 'A', '3', 'N'};
+static constexpr char MessageMagic[4] = {'C', 'A', '3', 'M'};
+static constexpr uint32_t Version = 1;
+static constexpr size_t Size = BOUNDS * BOUNDS * BOUNDS;
+
+/* sent once on connecting */
+struct Hello
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t bounds;
+};
+
+/* before every generation, rules.frame being the generation */
+struct Message
+{
+    char magic[4];
+    uint32_t keyframe;
+    uint32_t size;
+    Rules rules;
+};
+
+struct Viewer
+{
+    Socket socket;
+    bool started;
+};
+
+static Socket listener{-1};
+static std::thread thread;
+static std::mutex mutex;
+static std::condition_variable condition;
+static std::vector<uint8_t> queue[STREAM_QUEUE];
+static Rules queueRules[STREAM_QUEUE];
+static int queueHead;
+static int queueCount;
+static bool stopping;
+static bool streaming;
+static const Rules* source;
+static bool queued;
+static uint32_t queuedGeneration;
+static std::atomic<int> viewerCount;
+static std::atomic<uint64_t> sentBytes;
+
+static Socket connection{-1};
+static std::thread viewerThread;
+static std::mutex viewerMutex;
+static bool viewing;
+static std::atomic<bool> connected;
+static std::atomic<uint64_t> receivedBytes;
+static uint32_t viewerEvent;
+static EngineFrame received;
+static Rules receivedRules;
+static bool fresh;
+static EngineFrame acquired;
+
+static bool Send(Viewer& viewer, const Rules& rules, const std::vector<uint8_t>& data, bool keyframe)
+{
+    Message message{};
+    std::memcpy(message.magic, MessageMagic, sizeof(MessageMagic));
+    message.keyframe = keyframe;
+    message.size = data.size();
+    message.rules = rules;
+    if (!SendSocket(viewer.socket, &message, sizeof(message)) || !SendSocket(viewer.socket, data.data(), data.size()))
+    {
+        return false;
+    }
+    viewer.started = true;
+    sentBytes += sizeof(message) + data.size();
+    return true;
+}
+
+static void Run()
+{
+    SetTraceThread("Stream");
+    std::vector<Viewer> viewers;
+    std::vector<uint8_t> cells(Size);
+    std::vector<uint8_t> previous(Size);
+    std::vector<uint8_t> delta;
+    std::vector<uint8_t> keyframe;
+    Rules rules{};
+    Rules previousRules{};
+    bool sent = false;
+    while (true)
+    {
+        bool ready = false;
+        {
+            std::unique_lock lock(mutex);
+            /* wakes up now and then to accept viewers */
+            condition.wait_for(lock, std::chrono::milliseconds(50), [] { return queueCount || stopping; });
+            if (stopping)
+            {
+                break;
+            }
+            if (queueCount)
+            {
+                cells.swap(queue[queueHead]);
+                rules = queueRules[queueHead];
+                queueHead = (queueHead + 1) % STREAM_QUEUE;
+                queueCount--;
+                ready = true;
+            }
+        }
+        while (WaitSocket(listener, 0))
+        {
+            Socket socket = AcceptSocket(listener);
+            if (socket == -1)
+            {
+                break;
+            }
+            Hello hello{};
+            std::memcpy(hello.magic, Magic, sizeof(Magic));
+            hello.version = Version;
+            hello.bounds = BOUNDS;
+            SetSocketTimeout(socket, STREAM_TIMEOUT);
+            if (!SendSocket(socket, &hello, sizeof(hello)))
+            {
+                CloseSocket(socket);
+                continue;
+            }
+            Viewer viewer{socket, false};
+            /* the last generation sent, for when the simulation is paused */
+            if (sent)
+            {
+                EncodeDelta(previous.data(), nullptr, keyframe);
+                if (!Send(viewer, previousRules, keyframe, true))
+                {
+                    CloseSocket(socket);
+                    continue;
+                }
+            }
+            viewers.push_back(viewer);
+            viewerCount = viewers.size();
+            SDL_Log("Viewer connected (%zu viewing)", viewers.size());
+        }
+        if (!ready)
+        {
+            continue;
+        }
+        TRACE_SCOPE("Stream");
+        bool started = false;
+        bool starting = false;
+        for (const Viewer& viewer : viewers)
+        {
+            started |= viewer.started;
+            starting |= !viewer.started;
+        }
+        if (started)
+        {
+            EncodeDelta(cells.data(), previous.data(), delta);
+        }
+        if (starting)
+        {
+            EncodeDelta(cells.data(), nullptr, keyframe);
+        }
+        for (size_t i = 0; i < viewers.size();)
+        {
+            bool success = viewers[i].started ? Send(viewers[i], rules, delta, false) : Send(viewers[i], rules, keyframe, true);
+            if (success)
+            {
+                i++;
+                continue;
+            }
+            /* gone or too slow to keep up */
+            CloseSocket(viewers[i].socket);
+            viewers.erase(viewers.begin() + i);
+            viewerCount = viewers.size();
+            SDL_Log("Viewer disconnected (%zu viewing)", viewers.size());
+        }
+        previous.swap(cells);
+        previousRules = rules;
+        sent = true;
+    }
+    for (const Viewer& viewer : viewers)
+    {
+        CloseSocket(viewer.socket);
+    }
+    viewerCount = 0;
+}
+
+static void StreamCallback(uint32_t generation, const uint8_t* cells, void*)
+{
+    /* also requested for saving or the start of a recording */
+    if (queued && generation == queuedGeneration)
+    {
+        return;
+    }
+    {
+        std::lock_guard lock(mutex);
+        if (queueCount == STREAM_QUEUE)
+        {
+            /* the next one goes out as a delta from the last one sent */
+            return;
+        }
+        int index = (queueHead + queueCount) % STREAM_QUEUE;
+        std::memcpy(queue[index].data(), cells, Size);
+        queueRules[index] = *source;
+        queueRules[index].frame = generation;
+        queueCount++;
+    }
+    condition.notify_all();
+    queued = true;
+    queuedGeneration = generation;
+}
+
+bool StartStreaming(uint16_t port, const Rules* rules)
+{
+    StopStreaming();
+    listener = ListenTcp(port);
+    if (listener == -1)
+    {
+        return false;
+    }
+    if (!AddReadbackConsumer(StreamCallback, nullptr))
+    {
+        CloseSocket(listener);
+        listener = -1;
+        return false;
+    }
+    for (std::vector<uint8_t>& cells : queue)
+    {
+        cells.resize(Size);
+    }
+    source = rules;
+    queueHead = 0;
+    queueCount = 0;
+    stopping = false;
+    queued = false;
+    sentBytes = 0;
+    thread = std::thread(Run);
+    streaming = true;
+    SDL_Log("Streaming on port %u", port);
+    return true;
+}
+
+void StopStreaming()
+{
+    if (!streaming)
+    {
+        return;
+    }
+    RemoveReadbackConsumer(StreamCallback, nullptr);
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    thread.join();
+    streaming = false;
+    CloseSocket(listener);
+    listener = -1;
+    for (std::vector<uint8_t>& cells : queue)
+    {
+        cells = {};
+    }
+    SDL_Log("Streamed %llu bytes", static_cast<unsigned long long>(sentBytes));
+}
+
+bool IsStreaming()
+{
+    return streaming;
+}
+
+void GetStreamingStats(int& viewers, uint64_t& bytes)
+{
+    viewers = viewerCount;
+    bytes = sentBytes;
+}
+
+static void View()
+{
+    SetTraceThread("View");
+    std::vector<uint8_t> cells(Size);
+    std::vector<uint8_t> data;
+    bool started = false;
+    while (true)
+    {
+        Message message;
+        if (!ReceiveSocket(connection, &message, sizeof(message)))
+        {
+            break;
+        }
+        /* a keyframe of any size compresses to under twice the cells */
+        if (std::memcmp(message.magic, MessageMagic, sizeof(MessageMagic)) || message.size > Size * 2 + 16)
+        {
+            SDL_Log("Bad message from the stream");
+            break;
+        }
+        data.resize(message.size);
+        if (!ReceiveSocket(connection, data.data(), data.size()))
+        {
+            break;
+        }
+        TRACE_SCOPE("View");
+        if (!message.keyframe && !started)
+        {
+            SDL_Log("Stream started without a keyframe");
+            break;
+        }
+        if (!DecodeDelta(data.data(), data.size(), cells.data(), message.keyframe))
+        {
+            SDL_Log("Bad delta from the stream");
+            break;
+        }
+        started = true;
+        receivedBytes += sizeof(message) + data.size();
+        {
+            std::lock_guard lock(viewerMutex);
+            std::memcpy(received.cells, cells.data(), Size);
+            receivedRules = message.rules;
+            fresh = true;
+        }
+        SDL_Event event{};
+        event.type = viewerEvent;
+        SDL_PushEvent(&event);
+    }
+    connected = false;
+    /* so the main thread notices */
+    SDL_Event event{};
+    event.type = viewerEvent;
+    SDL_PushEvent(&event);
+}
+
+bool StartViewing(const char* address, uint32_t event)
+{
+    StopViewing();
+    std::string host = address;
+    size_t colon = host.rfind(':');
+    if (colon == std::string::npos)
+    {
+        SDL_Log("Expected host:port: %s", address);
+        return false;
+    }
+    uint16_t port = std::strtoul(host.c_str() + colon + 1, nullptr, 10);
+    host.resize(colon);
+    connection = ConnectTcp(host.c_str(), port);
+    if (connection == -1)
+    {
+        return false;
+    }
+    Hello hello;
+    if (!ReceiveSocket(connection, &hello, sizeof(hello)) || std::memcmp(hello.magic, Magic, sizeof(Magic)) ||
+        hello.version != Version || hello.bounds != BOUNDS)
+    {
+        SDL_Log("Not a stream for %d^3 cells: %s", BOUNDS, address);
+        CloseSocket(connection);
+        connection = -1;
+        return false;
+    }
+    viewerEvent = event;
+    fresh = false;
+    receivedBytes = 0;
+    connected = true;
+    viewerThread = std::thread(View);
+    viewing = true;
+    SDL_Log("Viewing %s", address);
+    return true;
+}
+
+void StopViewing()
+{
+    if (!viewing)
+    {
+        return;
+    }
+    ShutdownSocket(connection);
+    viewerThread.join();
+    CloseSocket(connection);
+    connection = -1;
+    viewing = false;
+    connected = false;
+    SDL_Log("Stopped viewing after %llu bytes", static_cast<unsigned long long>(receivedBytes));
+}
+
+bool IsViewing()
+{
+    return viewing;
+}
+
+bool IsViewerConnected()
+{
+    return connected;
+}
+
+uint64_t GetViewedBytes()
+{
+    return receivedBytes;
+}
+
+EngineFrame* AcquireViewedFrame(Rules& rules)
+{
+    {
+        std::lock_guard lock(viewerMutex);
+        if (!fresh)
+        {
+            return nullptr;
+        }
+        std::memcpy(acquired.cells, received.cells, Size);
+        rules = receivedRules;
+        fresh = false;
+    }
+    GetBricks(acquired.cells, acquired.bricks);
+    acquired.frame = rules.frame;
+    acquired.minZ = 0;
+    acquired.maxZ = BOUNDS - 1;
+    return &acquired;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include "engine.hpp"
+
+/* every read back generation is sent to the connected viewers as a delta of
+ * the one sent before, new viewers starting from a keyframe. the rules are
+ * read as each generation arrives */
+bool StartStreaming(uint16_t port, const Rules* rules);
+void StopStreaming();
+bool IsStreaming();
+void GetStreamingStats(int& viewers, uint64_t& bytes);
+
+/* a thread decodes the stream and pushes event for every generation, which
+ * is then acquired on the main thread to be uploaded */
+bool StartViewing(const char* address, uint32_t event);
+void StopViewing();
+bool IsViewing();
+bool IsViewerConnected();
+uint64_t GetViewedBytes();
+EngineFrame* AcquireViewedFrame(Rules& rules);
\ No newline at end of file
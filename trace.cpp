@@ -0,0 +1,226 @@
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#include "config.hpp"
+#include "trace.hpp"
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    int track;
+};
+
+enum
+{
+    BUFFER_FREE,
+    BUFFER_OWNED,
+    BUFFER_RELEASED,
+};
+
+/* single producer, single consumer */
+struct TraceBuffer
+{
+    TraceEvent events[TRACE_EVENTS];
+    std::atomic<uint32_t> write;
+    std::atomic<uint32_t> read;
+    std::atomic<int> state;
+    std::atomic<const char*> name;
+    std::atomic<int> thread;
+    std::atomic<int> session;
+};
+
+/* hands the buffer back when its thread exits */
+struct TraceOwner
+{
+    TraceBuffer* buffer;
+
+    ~TraceOwner()
+    {
+        if (buffer)
+        {
+            buffer->state.store(BUFFER_RELEASED, std::memory_order_release);
+        }
+    }
+};
+
+std::atomic<bool> tracing;
+
+/* never freed, a released buffer goes to the next new thread once drained */
+static std::atomic<TraceBuffer*> buffers[TRACE_THREADS];
+static std::atomic<int> nextThread;
+static thread_local TraceOwner owner;
+static thread_local const char* threadName{"Thread"};
+static FILE* file;
+static bool first;
+static uint64_t startTime;
+static int session;
+
+static bool Claim(TraceBuffer* buffer)
+{
+    int state = BUFFER_FREE;
+    if (buffer->state.compare_exchange_strong(state, BUFFER_OWNED))
+    {
+        return true;
+    }
+    /* events left by the thread that released it would be named after this one */
+    state = BUFFER_RELEASED;
+    return buffer->read.load(std::memory_order_acquire) == buffer->write.load(std::memory_order_relaxed) &&
+        buffer->state.compare_exchange_strong(state, BUFFER_OWNED);
+}
+
+static TraceBuffer* GetBuffer()
+{
+    if (owner.buffer)
+    {
+        return owner.buffer;
+    }
+    for (int i = 0; i < TRACE_THREADS; i++)
+    {
+        TraceBuffer* buffer = buffers[i].load();
+        if (!buffer)
+        {
+            TraceBuffer* created = new TraceBuffer{};
+            created->state.store(BUFFER_FREE);
+            if (!buffers[i].compare_exchange_strong(buffer, created))
+            {
+                delete created;
+            }
+            buffer = buffers[i].load();
+        }
+        if (!Claim(buffer))
+        {
+            continue;
+        }
+        /* a new id so the previous thread's events keep their name */
+        buffer->name.store(threadName);
+        buffer->thread.store(nextThread++ % TRACK_GPU);
+        buffer->session.store(0);
+        owner.buffer = buffer;
+        return buffer;
+    }
+    return nullptr;
+}
+
+static void Write(const char* format, auto... args)
+{
+    std::fprintf(file, first ? "\n" : ",\n");
+    std::fprintf(file, format, args...);
+    first = false;
+}
+
+bool StartTrace(const char* path)
+{
+    if (file)
+    {
+        return true;
+    }
+    file = std::fopen(path, "w");
+    if (!file)
+    {
+        SDL_Log("Failed to open trace: %s", path);
+        return false;
+    }
+    /* the json array format doesn't need the closing bracket */
+    std::fprintf(file, "[");
+    first = true;
+    startTime = SDL_GetTicksNS();
+    session++;
+    Write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", TRACK_GPU);
+    tracing.store(true);
+    SDL_Log("Tracing to %s", path);
+    return true;
+}
+
+void StopTrace()
+{
+    if (!file)
+    {
+        return;
+    }
+    tracing.store(false);
+    FlushTrace(true);
+    std::fprintf(file, "\n]\n");
+    std::fclose(file);
+    file = nullptr;
+    SDL_Log("Stopped tracing");
+}
+
+void FlushTrace(bool force)
+{
+    if (!file)
+    {
+        return;
+    }
+    for (int i = 0; i < TRACE_THREADS; i++)
+    {
+        TraceBuffer* buffer = buffers[i].load();
+        if (!buffer)
+        {
+            continue;
+        }
+        uint32_t read = buffer->read.load(std::memory_order_relaxed);
+        uint32_t write = buffer->write.load(std::memory_order_acquire);
+        /* drain once half full so producers rarely drop */
+        if (!force && write - read < TRACE_EVENTS / 2)
+        {
+            continue;
+        }
+        int thread = buffer->thread.load();
+        if (read != write && buffer->session.exchange(session) != session)
+        {
+            Write("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", thread, buffer->name.load());
+        }
+        for (; read != write; read++)
+        {
+            const TraceEvent& event = buffer->events[read % TRACE_EVENTS];
+            if (event.start < startTime)
+            {
+                continue;
+            }
+            int track = event.track == -1 ? thread : event.track;
+            Write("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                event.name, track, (event.start - startTime) / 1e3, (event.end - event.start) / 1e3);
+        }
+        buffer->read.store(read, std::memory_order_release);
+    }
+    std::fflush(file);
+}
+
+bool IsTracing()
+{
+    return tracing.load(std::memory_order_relaxed);
+}
+
+void SetTraceThread(const char* name)
+{
+    threadName = name;
+    if (owner.buffer)
+    {
+        owner.buffer->name.store(name);
+    }
+}
+
+void AddTraceEvent(const char* name, uint64_t start, uint64_t end, int track)
+{
+    if (!tracing.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    TraceBuffer* buffer = GetBuffer();
+    if (!buffer)
+    {
+        return;
+    }
+    uint32_t write = buffer->write.load(std::memory_order_relaxed);
+    if (write - buffer->read.load(std::memory_order_acquire) == TRACE_EVENTS)
+    {
+        return;
+    }
+    buffer->events[write % TRACE_EVENTS] = {name, start, end, track};
+    buffer->write.store(write + 1, std::memory_order_release);
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+
+#include <atomic>
+#include <cstdint>
+
+/* chrome trace event json, each thread appends to its own ring and the main
+ * thread drains them into the file */
+bool StartTrace(const char* path);
+void StopTrace();
+void FlushTrace(bool force);
+bool IsTracing();
+void SetTraceThread(const char* name);
+void AddTraceEvent(const char* name, uint64_t start, uint64_t end, int track = -1);
+
+/* pseudo threads for work that isn't on a cpu thread */
+enum
+{
+    TRACK_GPU = 1000,
+};
+
+extern std::atomic<bool> tracing;
+
+struct TraceScope
+{
+    const char* name;
+    uint64_t start;
+
+    TraceScope(const char* name)
+        : name{name}
+        , start{tracing.load(std::memory_order_relaxed) ? SDL_GetTicksNS() : 0}
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (start)
+        {
+            AddTraceEvent(name, start, SDL_GetTicksNS());
+        }
+    }
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__){name}
\ No newline at end of file
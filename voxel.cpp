@@ -0,0 +1,479 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "config.hpp"
+#include "engine.hpp"
+#include "voxel.hpp"
+
+/* largest model magicavoxel opens */
+static constexpr int Model = 256;
+static constexpr int Models = (BOUNDS + Model - 1) / Model;
+
+/* flushed to the file as it fills so exports stay small */
+struct Writer
+{
+    std::ofstream file;
+    std::vector<uint8_t> buffer;
+
+    void Write(const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+        if (buffer.size() >= 65536)
+        {
+            Flush();
+        }
+    }
+
+    void Write(int32_t value)
+    {
+        Write(&value, sizeof(value));
+    }
+
+    void Write(const char* id, int32_t content, int32_t children)
+    {
+        Write(id, 4);
+        Write(content);
+        Write(children);
+    }
+
+    void Write(const std::string& value)
+    {
+        Write(static_cast<int32_t>(value.size()));
+        Write(value.data(), value.size());
+    }
+
+    void Flush()
+    {
+        file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+        buffer.clear();
+    }
+
+    std::streamoff Tell()
+    {
+        return static_cast<std::streamoff>(file.tellp()) + buffer.size();
+    }
+
+    /* for sizes only known once the data after them is written */
+    void Patch(std::streamoff offset, int32_t value)
+    {
+        Flush();
+        std::streamoff end = file.tellp();
+        file.seekp(offset);
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        file.seekp(end);
+    }
+};
+
+/* the grid is y up and magicavoxel is z up */
+static int GetIndex(int vx, int vy, int vz)
+{
+    return (((BOUNDS - 1 - vy) * BOUNDS) + vz) * BOUNDS + vx;
+}
+
+static uint32_t GetColor(int value, uint32_t life)
+{
+    float t = std::min(1.0f, static_cast<float>(value) / std::max(1u, life));
+    uint32_t r = 255;
+    uint32_t g = static_cast<uint32_t>((1.0f - t) * 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(t * 255.0f + 0.5f);
+    return r | g << 8 | b << 16 | 0xFFu << 24;
+}
+
+static int GetModelSize(int model)
+{
+    return std::min(Model, BOUNDS - model * Model);
+}
+
+bool SaveVox(const char* path, const Rules& rules, const uint8_t* cells)
+{
+    Writer writer;
+    writer.file.open(path, std::ios::binary);
+    if (writer.file.fail())
+    {
+        SDL_Log("Failed to open vox: %s", path);
+        return false;
+    }
+    writer.Write("VOX ", 4);
+    writer.Write(150);
+    writer.Write("MAIN", 0, 0);
+    std::streamoff start = writer.Tell();
+    uint64_t voxels = 0;
+    for (int mz = 0; mz < Models; mz++)
+    for (int my = 0; my < Models; my++)
+    for (int mx = 0; mx < Models; mx++)
+    {
+        int sx = GetModelSize(mx);
+        int sy = GetModelSize(my);
+        int sz = GetModelSize(mz);
+        writer.Write("SIZE", 12, 0);
+        writer.Write(sx);
+        writer.Write(sy);
+        writer.Write(sz);
+        writer.Write("XYZI", 0, 0);
+        std::streamoff xyzi = writer.Tell();
+        writer.Write(0);
+        int32_t count = 0;
+        for (int z = 0; z < sz; z++)
+        for (int y = 0; y < sy; y++)
+        for (int x = 0; x < sx; x++)
+        {
+            uint8_t value = cells[GetIndex(mx * Model + x, my * Model + y, mz * Model + z)];
+            if (value)
+            {
+                uint8_t voxel[4] = {static_cast<uint8_t>(x), static_cast<uint8_t>(y), static_cast<uint8_t>(z), value};
+                writer.Write(voxel, sizeof(voxel));
+                count++;
+            }
+        }
+        writer.Patch(xyzi - 8, 4 + count * 4);
+        writer.Patch(xyzi, count);
+        voxels += count;
+    }
+    /* a root transform and group with a transform and shape for each model */
+    std::vector<int32_t> children;
+    for (int i = 0; i < Models * Models * Models; i++)
+    {
+        children.push_back(2 + i * 2);
+    }
+    writer.Write("nTRN", 28, 0);
+    writer.Write(0);
+    writer.Write(0);
+    writer.Write(1);
+    writer.Write(-1);
+    writer.Write(-1);
+    writer.Write(1);
+    writer.Write(0);
+    int32_t count = children.size();
+    writer.Write("nGRP", 12 + count * 4, 0);
+    writer.Write(1);
+    writer.Write(0);
+    writer.Write(count);
+    writer.Write(children.data(), children.size() * 4);
+    int model = 0;
+    for (int mz = 0; mz < Models; mz++)
+    for (int my = 0; my < Models; my++)
+    for (int mx = 0; mx < Models; mx++)
+    {
+        /* models are placed by their centers */
+        char translation[64];
+        std::snprintf(translation, sizeof(translation), "%d %d %d",
+            mx * Model + GetModelSize(mx) / 2,
+            my * Model + GetModelSize(my) / 2,
+            mz * Model + GetModelSize(mz) / 2);
+        std::string value = translation;
+        writer.Write("nTRN", 38 + static_cast<int32_t>(value.size()), 0);
+        writer.Write(2 + model * 2);
+        writer.Write(0);
+        writer.Write(3 + model * 2);
+        writer.Write(-1);
+        writer.Write(0);
+        writer.Write(1);
+        writer.Write(1);
+        writer.Write("_t");
+        writer.Write(value);
+        writer.Write("nSHP", 20, 0);
+        writer.Write(3 + model * 2);
+        writer.Write(0);
+        writer.Write(1);
+        writer.Write(model);
+        writer.Write(0);
+        model++;
+    }
+    writer.Write("RGBA", 1024, 0);
+    for (int i = 1; i <= 256; i++)
+    {
+        writer.Write(static_cast<int32_t>(GetColor(i, rules.life)));
+    }
+    writer.Patch(start - 4, writer.Tell() - start);
+    if (writer.file.fail())
+    {
+        SDL_Log("Failed to write vox: %s", path);
+        return false;
+    }
+    SDL_Log("Saved %llu voxels to %s", static_cast<unsigned long long>(voxels), path);
+    return true;
+}
+
+struct Chunk
+{
+    char id[4];
+    int32_t content;
+    int32_t children;
+};
+
+static bool Read(std::ifstream& file, int32_t& value)
+{
+    file.read(reinterpret_cast<char*>(&value), sizeof(value));
+    return !file.fail();
+}
+
+static bool Read(std::ifstream& file, std::string& value)
+{
+    int32_t size;
+    if (!Read(file, size) || size < 0 || size > 4096)
+    {
+        return false;
+    }
+    value.resize(size);
+    file.read(value.data(), size);
+    return !file.fail();
+}
+
+static bool Read(std::ifstream& file, std::map<std::string, std::string>& dict)
+{
+    int32_t count;
+    if (!Read(file, count) || count < 0 || count > 256)
+    {
+        return false;
+    }
+    dict.clear();
+    for (int i = 0; i < count; i++)
+    {
+        std::string key;
+        std::string value;
+        if (!Read(file, key) || !Read(file, value))
+        {
+            return false;
+        }
+        dict[key] = value;
+    }
+    return true;
+}
+
+struct VoxModel
+{
+    int size[3];
+    int origin[3];
+    std::streamoff voxels;
+    int32_t count;
+};
+
+bool LoadVox(const char* path, uint32_t life, uint8_t* cells)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    int32_t version;
+    file.read(magic, sizeof(magic));
+    if (file.fail() || std::memcmp(magic, "VOX ", 4) || !Read(file, version))
+    {
+        SDL_Log("Invalid vox: %s", path);
+        return false;
+    }
+    /* headers and the scene first, the voxels are streamed in afterwards */
+    std::vector<VoxModel> models;
+    std::map<int32_t, std::vector<int>> translations;
+    std::map<int32_t, int32_t> shapes;
+    Chunk chunk;
+    while (file.read(reinterpret_cast<char*>(&chunk), sizeof(chunk)))
+    {
+        if (chunk.content < 0 || chunk.children < 0)
+        {
+            break;
+        }
+        std::streamoff next = static_cast<std::streamoff>(file.tellg()) + chunk.content;
+        if (!std::memcmp(chunk.id, "SIZE", 4))
+        {
+            VoxModel& model = models.emplace_back();
+            if (!Read(file, model.size[0]) || !Read(file, model.size[1]) || !Read(file, model.size[2]))
+            {
+                break;
+            }
+            std::fill(model.origin, model.origin + 3, 0);
+            model.voxels = -1;
+            model.count = 0;
+        }
+        else if (!std::memcmp(chunk.id, "XYZI", 4) && !models.empty())
+        {
+            VoxModel& model = models.back();
+            if (!Read(file, model.count))
+            {
+                break;
+            }
+            model.voxels = file.tellg();
+        }
+        else if (!std::memcmp(chunk.id, "nTRN", 4))
+        {
+            int32_t node;
+            int32_t child;
+            int32_t reserved;
+            int32_t layer;
+            int32_t frames;
+            std::map<std::string, std::string> dict;
+            if (!Read(file, node) || !Read(file, dict) || !Read(file, child) || !Read(file, reserved) ||
+                !Read(file, layer) || !Read(file, frames))
+            {
+                break;
+            }
+            if (frames > 0 && Read(file, dict) && dict.count("_t"))
+            {
+                std::vector<int>& translation = translations[child];
+                translation.assign(3, 0);
+                std::sscanf(dict["_t"].c_str(), "%d %d %d", &translation[0], &translation[1], &translation[2]);
+            }
+        }
+        else if (!std::memcmp(chunk.id, "nSHP", 4))
+        {
+            int32_t node;
+            int32_t count;
+            int32_t model;
+            std::map<std::string, std::string> dict;
+            if (Read(file, node) && Read(file, dict) && Read(file, count) && count > 0 && Read(file, model))
+            {
+                shapes[node] = model;
+            }
+        }
+        /* children are chunks of their own and simply come next */
+        file.clear();
+        file.seekg(next);
+    }
+    file.clear();
+    if (models.empty())
+    {
+        SDL_Log("Invalid vox: %s", path);
+        return false;
+    }
+    /* without a scene every model sits at the origin, otherwise shift them
+     * so that the lowest corner is at the origin of the grid */
+    int low[3] = {INT32_MAX, INT32_MAX, INT32_MAX};
+    for (const auto& [node, model] : shapes)
+    {
+        if (model < 0 || model >= static_cast<int>(models.size()) || !translations.count(node))
+        {
+            continue;
+        }
+        VoxModel& voxModel = models[model];
+        for (int i = 0; i < 3; i++)
+        {
+            voxModel.origin[i] = translations[node][i] - voxModel.size[i] / 2;
+        }
+    }
+    for (const VoxModel& model : models)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            low[i] = std::min(low[i], model.origin[i]);
+        }
+    }
+    std::memset(cells, 0, BOUNDS * BOUNDS * BOUNDS);
+    uint64_t skipped = 0;
+    std::vector<uint8_t> voxels;
+    for (const VoxModel& model : models)
+    {
+        if (model.voxels < 0 || model.count <= 0)
+        {
+            continue;
+        }
+        file.seekg(model.voxels);
+        int32_t remaining = model.count;
+        while (remaining > 0)
+        {
+            int32_t count = std::min(remaining, 16384);
+            voxels.resize(count * 4);
+            if (!file.read(reinterpret_cast<char*>(voxels.data()), voxels.size()))
+            {
+                SDL_Log("Truncated vox: %s", path);
+                return false;
+            }
+            for (int32_t i = 0; i < count; i++)
+            {
+                const uint8_t* voxel = voxels.data() + i * 4;
+                int vx = model.origin[0] - low[0] + voxel[0];
+                int vy = model.origin[1] - low[1] + voxel[1];
+                int vz = model.origin[2] - low[2] + voxel[2];
+                if (vx >= BOUNDS || vy >= BOUNDS || vz >= BOUNDS)
+                {
+                    skipped++;
+                    continue;
+                }
+                cells[GetIndex(vx, vy, vz)] = std::min<uint32_t>(voxel[3], life);
+            }
+            remaining -= count;
+        }
+    }
+    if (skipped)
+    {
+        SDL_Log("Skipped %llu voxels outside of the grid", static_cast<unsigned long long>(skipped));
+    }
+    return true;
+}
+
+bool SavePoints(const char* path, const Rules& rules, const uint8_t* cells)
+{
+    std::ofstream file(path);
+    if (file.fail())
+    {
+        SDL_Log("Failed to open points: %s", path);
+        return false;
+    }
+    file << "# bounds " << BOUNDS << " life " << rules.life << " generation " << rules.frame << "\n";
+    uint64_t points = 0;
+    char line[32];
+    for (int z = 0; z < BOUNDS; z++)
+    for (int y = 0; y < BOUNDS; y++)
+    for (int x = 0; x < BOUNDS; x++)
+    {
+        uint8_t value = cells[(z * BOUNDS + y) * BOUNDS + x];
+        if (value)
+        {
+            int size = std::snprintf(line, sizeof(line), "%d %d %d %d\n", x, y, z, value);
+            file.write(line, size);
+            points++;
+        }
+    }
+    if (file.fail())
+    {
+        SDL_Log("Failed to write points: %s", path);
+        return false;
+    }
+    SDL_Log("Saved %llu points to %s", static_cast<unsigned long long>(points), path);
+    return true;
+}
+
+bool LoadPoints(const char* path, uint32_t life, uint8_t* cells)
+{
+    std::ifstream file(path);
+    if (file.fail())
+    {
+        SDL_Log("Failed to open points: %s", path);
+        return false;
+    }
+    std::memset(cells, 0, BOUNDS * BOUNDS * BOUNDS);
+    uint64_t skipped = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        int x;
+        int y;
+        int z;
+        int value;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        if (std::sscanf(line.c_str(), "%d %d %d %d", &x, &y, &z, &value) != 4)
+        {
+            SDL_Log("Invalid points: %s", path);
+            return false;
+        }
+        if (x < 0 || y < 0 || z < 0 || x >= BOUNDS || y >= BOUNDS || z >= BOUNDS)
+        {
+            skipped++;
+            continue;
+        }
+        cells[(z * BOUNDS + y) * BOUNDS + x] = std::clamp<int>(value, 0, life);
+    }
+    if (skipped)
+    {
+        SDL_Log("Skipped %llu points outside of the grid", static_cast<unsigned long long>(skipped));
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+#include "engine.hpp"
+
+/* magicavoxel files split into models of at most 256^3 with a palette
+ * matching render.frag, the voxels being indexed by value */
+bool SaveVox(const char* path, const Rules& rules, const uint8_t* cells);
+bool LoadVox(const char* path, uint32_t life, uint8_t* cells);
+
+/* a text file of x y z value lines for the live cells */
+bool SavePoints(const char* path, const Rules& rules, const uint8_t* cells);
+bool LoadPoints(const char* path, uint32_t life, uint8_t* cells);
\ No newline at end of file
@@ -0,0 +1,471 @@
+#include <SDL3/SDL.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "config.hpp"
+#include "engine.hpp"
+#include "trace.hpp"
+#include "world.hpp"
+
+static constexpr int Side = WORLD_CHUNK;
+static constexpr int Padded = Side + 2;
+static constexpr size_t ChunkSize = Side * Side * Side;
+
+struct Chunk
+{
+    std::vector<uint8_t> cells;
+    uint32_t live;
+    /* generations the cells last changed and the chunk was last needed */
+    uint32_t changed;
+    uint32_t used;
+    /* a copy in the store that is still current, or -1 */
+    int64_t slot;
+    std::list<uint64_t>::iterator lru;
+};
+
+struct Stored
+{
+    int64_t slot;
+    uint32_t live;
+    uint32_t changed;
+};
+
+static std::unordered_map<uint64_t, Chunk> chunks;
+static std::unordered_map<uint64_t, Stored> stored;
+/* resident chunks, most recently needed first */
+static std::list<uint64_t> lru;
+static std::vector<uint64_t> changedKeys;
+static std::string storePath;
+static std::fstream store;
+static std::vector<int64_t> freeSlots;
+static int64_t slots;
+static Rules rules;
+static size_t budget;
+static size_t stepped;
+static uint64_t live;
+static uint64_t pageIns;
+static uint64_t pageOuts;
+static bool overBudget;
+
+/* 21 bits per axis, so a world can grow to 2^25 cells either way */
+static uint64_t GetKey(int x, int y, int z)
+{
+    return (static_cast<uint64_t>(x & 0x1FFFFF) << 42) | (static_cast<uint64_t>(y & 0x1FFFFF) << 21) | (z & 0x1FFFFF);
+}
+
+static int GetAxis(uint64_t key, int shift)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>((key >> shift) & 0x1FFFFF) << 11) >> 11;
+}
+
+template <typename Function>
+static void ForEachChunk(size_t count, Function function)
+{
+    size_t threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(count, 1));
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads; i++)
+    {
+        workers.emplace_back([&, i]
+        {
+            for (size_t j = count * i / threads; j < count * (i + 1) / threads; j++)
+            {
+                function(j);
+            }
+        });
+    }
+    for (size_t j = 0; j < count / threads; j++)
+    {
+        function(j);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+static Chunk& Insert(uint64_t key)
+{
+    Chunk& chunk = chunks[key];
+    chunk.slot = -1;
+    lru.push_front(key);
+    chunk.lru = lru.begin();
+    return chunk;
+}
+
+static void Erase(uint64_t key)
+{
+    Chunk& chunk = chunks.at(key);
+    if (chunk.slot >= 0)
+    {
+        freeSlots.push_back(chunk.slot);
+    }
+    lru.erase(chunk.lru);
+    chunks.erase(key);
+}
+
+static bool PageIn(uint64_t key)
+{
+    auto it = stored.find(key);
+    if (it == stored.end())
+    {
+        return true;
+    }
+    TRACE_SCOPE("PageIn");
+    Chunk& chunk = Insert(key);
+    chunk.cells.resize(ChunkSize);
+    chunk.live = it->second.live;
+    chunk.changed = it->second.changed;
+    /* the copy stays until the chunk changes so paging it out again is free */
+    chunk.slot = it->second.slot;
+    stored.erase(it);
+    store.seekg(chunk.slot * ChunkSize);
+    if (!store.read(reinterpret_cast<char*>(chunk.cells.data()), ChunkSize))
+    {
+        SDL_Log("Failed to read chunk store: %s", storePath.c_str());
+        return false;
+    }
+    pageIns++;
+    return true;
+}
+
+static bool PageOut(uint64_t key)
+{
+    TRACE_SCOPE("PageOut");
+    Chunk& chunk = chunks.at(key);
+    if (chunk.slot < 0)
+    {
+        if (freeSlots.empty())
+        {
+            chunk.slot = slots++;
+        }
+        else
+        {
+            chunk.slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        store.seekp(chunk.slot * ChunkSize);
+        if (!store.write(reinterpret_cast<const char*>(chunk.cells.data()), ChunkSize))
+        {
+            SDL_Log("Failed to write chunk store: %s", storePath.c_str());
+            return false;
+        }
+    }
+    stored[key] = {chunk.slot, chunk.live, chunk.changed};
+    /* the slot now belongs to the stored copy */
+    chunk.slot = -1;
+    Erase(key);
+    pageOuts++;
+    return true;
+}
+
+static bool Evict()
+{
+    /* only chunks no change has come near for a while, so growth doesn't
+     * page out what the next generations are about to read */
+    while (chunks.size() * ChunkSize > budget && !lru.empty())
+    {
+        uint64_t key = lru.back();
+        if (chunks.at(key).used + WORLD_STILL > rules.frame)
+        {
+            if (!overBudget)
+            {
+                SDL_Log("World needs %zu MB resident, over its budget", chunks.size() * ChunkSize >> 20);
+                overBudget = true;
+            }
+            return true;
+        }
+        if (!PageOut(key))
+        {
+            return false;
+        }
+    }
+    overBudget = false;
+    store.flush();
+    return true;
+}
+
+/* the chunk and a cell of each neighbor around it, empty where there are none */
+static void Gather(const uint8_t* const neighbors[27], uint8_t* padded)
+{
+    for (int z = 0; z < Padded; z++)
+    for (int y = 0; y < Padded; y++)
+    {
+        int cz = z == 0 ? 0 : z == Padded - 1 ? 2 : 1;
+        int cy = y == 0 ? 0 : y == Padded - 1 ? 2 : 1;
+        int lz = (z + Side - 1) % Side;
+        int ly = (y + Side - 1) % Side;
+        uint8_t* row = padded + (z * Padded + y) * Padded;
+        for (int cx = 0; cx < 3; cx++)
+        {
+            const uint8_t* cells = neighbors[(cz * 3 + cy) * 3 + cx];
+            int x0 = cx == 0 ? Side - 1 : 0;
+            int x1 = cx == 1 ? Side : x0 + 1;
+            uint8_t* out = row + (cx == 0 ? 0 : cx == 1 ? 1 : Padded - 1);
+            for (int x = x0; x < x1; x++)
+            {
+                *out++ = cells && cells[(lz * Side + ly) * Side + x] > 0;
+            }
+        }
+    }
+}
+
+/* returns the live cells, with the moore count summed a box axis at a time */
+static uint32_t StepChunk(const uint8_t* const neighbors[27], uint8_t* out)
+{
+    thread_local std::vector<uint8_t> padded(Padded * Padded * Padded);
+    thread_local std::vector<uint8_t> rows(Padded * Padded * Side);
+    thread_local std::vector<uint8_t> planes(Padded * Side * Side);
+    Gather(neighbors, padded.data());
+    const uint8_t* cells = neighbors[13];
+    auto GetPadded = [&](int x, int y, int z) { return padded[((z + 1) * Padded + y + 1) * Padded + x + 1]; };
+    if (rules.neighborhood != VON_NEUMANN)
+    {
+        for (int z = 0; z < Padded; z++)
+        for (int y = 0; y < Padded; y++)
+        for (int x = 0; x < Side; x++)
+        {
+            const uint8_t* row = &padded[(z * Padded + y) * Padded + x];
+            rows[(z * Padded + y) * Side + x] = row[0] + row[1] + row[2];
+        }
+        for (int z = 0; z < Padded; z++)
+        for (int y = 0; y < Side; y++)
+        for (int x = 0; x < Side; x++)
+        {
+            const uint8_t* column = &rows[(z * Padded + y) * Side + x];
+            planes[(z * Side + y) * Side + x] = column[0] + column[Side] + column[Side * 2];
+        }
+    }
+    uint32_t count = 0;
+    for (int z = 0; z < Side; z++)
+    for (int y = 0; y < Side; y++)
+    for (int x = 0; x < Side; x++)
+    {
+        int index = (z * Side + y) * Side + x;
+        uint32_t neighbors;
+        if (rules.neighborhood == VON_NEUMANN)
+        {
+            neighbors = GetPadded(x - 1, y, z) + GetPadded(x + 1, y, z) + GetPadded(x, y - 1, z) +
+                GetPadded(x, y + 1, z) + GetPadded(x, y, z - 1) + GetPadded(x, y, z + 1);
+        }
+        else
+        {
+            const uint8_t* box = &planes[index];
+            neighbors = box[0] + box[Side * Side] + box[Side * Side * 2] - GetPadded(x, y, z);
+        }
+        out[index] = GetNextCell(rules, cells ? cells[index] : 0, neighbors);
+        count += out[index] > 0;
+    }
+    return count;
+}
+
+bool CreateWorld(const char* path, uint32_t size, const Rules& initial, size_t bytes)
+{
+    if (initial.birthMask & 1)
+    {
+        SDL_Log("Failed to create world: births without neighbors would fill it");
+        return false;
+    }
+    storePath = path;
+    store.open(path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+    if (store.fail())
+    {
+        SDL_Log("Failed to open chunk store: %s", path);
+        return false;
+    }
+    /* the seed and the copy after it, like an imported grid */
+    rules = initial;
+    rules.frame = 2;
+    budget = bytes;
+    int count = (size + Side - 1) / Side;
+    std::vector<uint64_t> keys;
+    for (int z = 0; z < count; z++)
+    for (int y = 0; y < count; y++)
+    for (int x = 0; x < count; x++)
+    {
+        keys.push_back(GetKey(x, y, z));
+    }
+    std::vector<std::vector<uint8_t>> results(keys.size());
+    std::vector<uint32_t> counts(keys.size());
+    ForEachChunk(keys.size(), [&](size_t i)
+    {
+        thread_local std::vector<uint8_t> scratch(ChunkSize);
+        std::fill(scratch.begin(), scratch.end(), 0);
+        int x0 = GetAxis(keys[i], 42) * Side;
+        int y0 = GetAxis(keys[i], 21) * Side;
+        int z0 = GetAxis(keys[i], 0) * Side;
+        for (int z = 0; z < Side && z0 + z < static_cast<int>(size); z++)
+        for (int y = 0; y < Side && y0 + y < static_cast<int>(size); y++)
+        for (int x = 0; x < Side && x0 + x < static_cast<int>(size); x++)
+        {
+            uint8_t& cell = scratch[(z * Side + y) * Side + x];
+            cell = GetSeedCell(rules.seed, x0 + x, y0 + y, z0 + z);
+            counts[i] += cell > 0;
+        }
+        if (counts[i])
+        {
+            results[i] = scratch;
+        }
+    });
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (!counts[i])
+        {
+            continue;
+        }
+        Chunk& chunk = Insert(keys[i]);
+        chunk.cells.swap(results[i]);
+        chunk.live = counts[i];
+        chunk.changed = rules.frame;
+        chunk.used = rules.frame;
+        changedKeys.push_back(keys[i]);
+        live += counts[i];
+    }
+    SDL_Log("Created a world of %zu chunks of %d^3 with a %zu MB budget", chunks.size(), Side, budget >> 20);
+    return Evict();
+}
+
+void DestroyWorld()
+{
+    chunks.clear();
+    stored.clear();
+    lru.clear();
+    changedKeys.clear();
+    freeSlots.clear();
+    slots = 0;
+    stepped = 0;
+    live = 0;
+    pageIns = 0;
+    pageOuts = 0;
+    overBudget = false;
+    if (store.is_open())
+    {
+        store.close();
+        std::remove(storePath.c_str());
+    }
+}
+
+bool StepWorld()
+{
+    TRACE_SCOPE("StepWorld");
+    /* anything else is still since its neighborhood didn't change either */
+    std::unordered_set<uint64_t> keySet;
+    for (uint64_t key : changedKeys)
+    {
+        int x = GetAxis(key, 42);
+        int y = GetAxis(key, 21);
+        int z = GetAxis(key, 0);
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            keySet.insert(GetKey(x + dx, y + dy, z + dz));
+        }
+    }
+    std::vector<uint64_t> keys(keySet.begin(), keySet.end());
+    /* paged back in once a stepped chunk reads them */
+    std::vector<const uint8_t*> neighbors(keys.size() * 27);
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        int x = GetAxis(keys[i], 42);
+        int y = GetAxis(keys[i], 21);
+        int z = GetAxis(keys[i], 0);
+        for (int dz = -1; dz <= 1; dz++)
+        for (int dy = -1; dy <= 1; dy++)
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            uint64_t key = GetKey(x + dx, y + dy, z + dz);
+            if (!PageIn(key))
+            {
+                return false;
+            }
+            auto it = chunks.find(key);
+            if (it == chunks.end())
+            {
+                continue;
+            }
+            Chunk& chunk = it->second;
+            chunk.used = rules.frame;
+            lru.splice(lru.begin(), lru, chunk.lru);
+            neighbors[i * 27 + (dz + 1) * 9 + (dy + 1) * 3 + dx + 1] = chunk.cells.data();
+        }
+    }
+    /* stepped into scratch, only the chunks that changed getting new cells,
+     * so the memory beyond the resident chunks is what changed this step */
+    std::vector<std::vector<uint8_t>> results(keys.size());
+    std::vector<uint32_t> counts(keys.size());
+    {
+        TRACE_SCOPE("Step");
+        ForEachChunk(keys.size(), [&](size_t i)
+        {
+            thread_local std::vector<uint8_t> scratch(ChunkSize);
+            counts[i] = StepChunk(&neighbors[i * 27], scratch.data());
+            const uint8_t* cells = neighbors[i * 27 + 13];
+            if (cells ? std::memcmp(cells, scratch.data(), ChunkSize) : counts[i])
+            {
+                results[i] = scratch;
+            }
+        });
+    }
+    rules.frame++;
+    changedKeys.clear();
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (results[i].empty())
+        {
+            continue;
+        }
+        auto it = chunks.find(keys[i]);
+        if (it == chunks.end())
+        {
+            Chunk& chunk = Insert(keys[i]);
+            chunk.cells.swap(results[i]);
+            chunk.live = counts[i];
+            chunk.changed = rules.frame;
+            chunk.used = rules.frame;
+            changedKeys.push_back(keys[i]);
+            live += counts[i];
+            continue;
+        }
+        Chunk& chunk = it->second;
+        chunk.cells.swap(results[i]);
+        live += counts[i];
+        live -= chunk.live;
+        chunk.live = counts[i];
+        chunk.changed = rules.frame;
+        changedKeys.push_back(keys[i]);
+        if (chunk.slot >= 0)
+        {
+            freeSlots.push_back(chunk.slot);
+            chunk.slot = -1;
+        }
+        if (!chunk.live)
+        {
+            /* empty chunks are the same as missing ones */
+            Erase(keys[i]);
+        }
+    }
+    stepped = keys.size();
+    return Evict();
+}
+
+void GetWorldStats(WorldStats& stats)
+{
+    stats.frame = rules.frame;
+    stats.resident = chunks.size();
+    stats.paged = stored.size();
+    stats.stepped = stepped;
+    stats.live = live;
+    stats.pageIns = pageIns;
+    stats.pageOuts = pageOuts;
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "engine.hpp"
+
+struct WorldStats
+{
+    uint32_t frame;
+    size_t resident;
+    size_t paged;
+    size_t stepped;
+    uint64_t live;
+    uint64_t pageIns;
+    uint64_t pageOuts;
+};
+
+/* an unbounded grid of chunks stepped on the cpu only around chunks that
+ * changed, with chunks that stayed away from any change the longest paged
+ * out to a scratch file while over budget, not thread safe */
+bool CreateWorld(const char* path, uint32_t size, const Rules& rules, size_t budget);
+void DestroyWorld();
+bool StepWorld();
+void GetWorldStats(WorldStats& stats);
\ No newline at end of file